@@ -0,0 +1,12 @@
+// marks the time when element-web rendered either the main view or one of the
+// login/welcome pages, which is the earliest point a user can interact with it
+(() => {
+    const selectors = ".mx_MatrixChat_wrapper, .mx_AuthPage, .mx_Welcome";
+    const observer = new MutationObserver(() => {
+        if (window.__qelement_app_ready === undefined && document.querySelector(selectors)) {
+            window.__qelement_app_ready = performance.now();
+            observer.disconnect();
+        }
+    });
+    observer.observe(document, {childList: true, subtree: true});
+})();
@@ -0,0 +1,4 @@
+// return a proper device name instead of an ugly url
+whenPlatform((platform) => {
+    platform.getDefaultDeviceDisplayName = () => __DEVICE_NAME__;
+});
@@ -0,0 +1,32 @@
+// provides the native event index of QElement as the event indexing manager of the platform,
+// which enables message search in encrypted rooms, the methods follow BaseEventIndexManager of element-web
+const pending = new Map();
+const native = window.__qelement_channel.then((objects) => {
+    const index = objects && objects.qelementEventIndex;
+    if (!index) return null;
+    index.replied.connect((requestId, result, error) => {
+        const callbacks = pending.get(requestId);
+        pending.delete(requestId);
+        if (!callbacks) return;
+        if (error) callbacks.reject(new Error(error));
+        else callbacks.resolve(result);
+    });
+    return index;
+});
+const call = async (method, ...args) => {
+    const index = await native;
+    if (!index) throw new Error("event index not available");
+    const requestId = await new Promise((resolve) => index.request(method, args, resolve));
+    return new Promise((resolve, reject) => pending.set(requestId, {resolve: resolve, reject: reject}));
+};
+const manager = {};
+[
+    "initEventIndex", "addEventToIndex", "deleteEvent", "isEventIndexEmpty", "isRoomIndexed",
+    "commitLiveEvents", "searchEventIndex", "addHistoricEvents", "addCrawlerCheckpoint",
+    "removeCrawlerCheckpoint", "loadFileEvents", "loadCheckpoints", "setUserVersion",
+    "getUserVersion", "getStats", "closeEventIndex", "deleteEventIndex",
+].forEach((method) => manager[method] = (...args) => call(method, ...args));
+manager.supportsEventIndexing = async () => (await native) !== null && call("supportsEventIndexing");
+whenPlatform((platform) => {
+    platform.getEventIndexingManager = () => manager;
+});
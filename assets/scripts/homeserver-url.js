@@ -0,0 +1,2 @@
+// homeserver url for the network monitor, always reflects the current session
+Object.defineProperty(window, "mx_hs_url", {get: () => localStorage.getItem("mx_hs_url")});
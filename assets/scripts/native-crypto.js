@@ -0,0 +1,26 @@
+// exposes the native megolm decryption of QElement as window.qelementCrypto,
+// decryptBatch resolves to null when the native bridge is unavailable and
+// single results carry an error when they must be decrypted with the WASM implementation
+const pending = new Map();
+let native = null;
+const ready = window.__qelement_channel.then((objects) => {
+    native = objects && objects.qelementCrypto;
+    if (!native) return false;
+    native.batchDecrypted.connect((batchId, results) => {
+        const callback = pending.get(batchId);
+        pending.delete(batchId);
+        if (callback) callback(results);
+    });
+    return true;
+});
+const call = (method, ...args) => new Promise((resolve) => native[method](...args, resolve));
+window.qelementCrypto = {
+    ready: ready,
+    importSession: async (sessionId, key, exported) => (await ready) && call("importSession", sessionId, key, !!exported),
+    hasSession: async (sessionId) => (await ready) && call("hasSession", sessionId),
+    decryptBatch: async (events) => {
+        if (!(await ready)) return null;
+        const batchId = await call("decryptBatch", events);
+        return new Promise((resolve) => pending.set(batchId, resolve));
+    },
+};
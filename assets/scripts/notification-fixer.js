@@ -0,0 +1,7 @@
+// notifications are reset to disabled on every app restart and reload,
+// enable them once the settings store and the platform are available
+whenDefined("mxSettingsStore", (store) => whenPlatform(() => {
+    for (const setting of ["notificationsEnabled", "notificationBodyEnabled", "audioNotificationsEnabled"]) {
+        try { Promise.resolve(store.setValue(setting, null, "device", true)).catch(() => {}); } catch (e) {}
+    }
+}));
@@ -0,0 +1,30 @@
+// shared helpers, prepended to every injected script
+// calls callback once with the value as soon as element-web assigns the global
+const whenDefined = (name, callback) => {
+    if (window[name] !== undefined) {
+        callback(window[name]);
+        return;
+    }
+    const previous = Object.getOwnPropertyDescriptor(window, name);
+    Object.defineProperty(window, name, {
+        configurable: true,
+        enumerable: true,
+        get: () => undefined,
+        set: (value) => {
+            Object.defineProperty(window, name, {configurable: true, enumerable: true, writable: true, value: value});
+            if (previous && previous.set) previous.set(value);
+            callback(value);
+        },
+    });
+};
+// calls callback once for every platform element-web installs into the PlatformPeg
+const whenPlatform = (callback) => {
+    whenDefined("mxPlatformPeg", (peg) => {
+        if (peg.get()) callback(peg.get());
+        const set = peg.set.bind(peg);
+        peg.set = (platform) => {
+            if (platform) callback(platform);
+            set(platform);
+        };
+    });
+};
@@ -0,0 +1,12 @@
+// connects to the QWebChannel of the page once and shares its objects with the other scripts,
+// resolves to null when the page has no web channel
+__QWEBCHANNEL__
+Object.defineProperty(window, "__qelement_channel", {
+    value: new Promise((resolve) => {
+        if (typeof qt === "undefined" || !qt.webChannelTransport) {
+            resolve(null);
+            return;
+        }
+        new QWebChannel(qt.webChannelTransport, (channel) => resolve(channel.objects));
+    }),
+});
@@ -0,0 +1,300 @@
+#include "benchmark.hpp"
+#include "elementurlscheme.hpp"
+#include "userscripts.hpp"
+
+#include <QWebEngineProfile>
+#include <QWebEnginePage>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QTimer>
+#include <QDebug>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+// interval to query the markers from the page after loadFinished
+constexpr const int pollInterval = 50;
+
+// give up on a run when the app didn't become ready in time
+constexpr const int runTimeout = 60 * 1000;
+
+static const char *queryScript = R"(
+(function() {
+    const paint = {};
+    performance.getEntriesByType("paint").forEach(e => paint[e.name] = e.startTime);
+    return JSON.stringify({
+        origin: performance.timeOrigin,
+        fp: paint["first-paint"],
+        fcp: paint["first-contentful-paint"],
+        ready: window.__qelement_app_ready,
+        serviceWorker: !!(navigator.serviceWorker && navigator.serviceWorker.controller),
+    });
+})();
+)";
+
+// wall clock in ms since the epoch, the clock of performance.timeOrigin
+static double epochTime()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static double median(const QList<Benchmark::Result> &results, double Benchmark::Result::*field)
+{
+    std::vector<double> values;
+    for (auto&& result : results)
+    {
+        if (result.*field >= 0)
+        {
+            values.push_back(result.*field);
+        }
+    }
+
+    if (values.empty())
+    {
+        return -1;
+    }
+
+    std::sort(values.begin(), values.end());
+    const auto middle = values.size() / 2;
+    return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+}
+
+static QJsonObject toJson(const Benchmark::Result &result)
+{
+    return {
+        {"timeToFirstByte", result.timeToFirstByte},
+        {"loadFinished", result.loadFinished},
+        {"firstPaint", result.firstPaint},
+        {"firstContentfulPaint", result.firstContentfulPaint},
+        {"appReady", result.appReady},
+    };
+}
+
+static QJsonObject toJson(const QList<Benchmark::Result> &results)
+{
+    QJsonArray runs;
+    auto serviceWorkerRuns = 0;
+    for (auto&& result : results)
+    {
+        auto run = toJson(result);
+        run.insert("serviceWorker", result.serviceWorker);
+        runs.append(run);
+        serviceWorkerRuns += result.serviceWorker;
+    }
+
+    Benchmark::Result medians;
+    medians.timeToFirstByte = median(results, &Benchmark::Result::timeToFirstByte);
+    medians.loadFinished = median(results, &Benchmark::Result::loadFinished);
+    medians.firstPaint = median(results, &Benchmark::Result::firstPaint);
+    medians.firstContentfulPaint = median(results, &Benchmark::Result::firstContentfulPaint);
+    medians.appReady = median(results, &Benchmark::Result::appReady);
+
+    return {
+        {"runs", runs},
+        {"serviceWorkerRuns", serviceWorkerRuns},
+        {"median", toJson(medians)},
+    };
+}
+
+Benchmark::Benchmark(QWebEngineProfile *profile, ElementUrlScheme *handler, QObject *parent)
+    : QObject(parent)
+{
+    this->profile = profile;
+    this->handler = handler;
+
+    UserScripts::install(this->profile);
+    connect(this->handler, &ElementUrlScheme::requestHandled, this, &Benchmark::requestHandled);
+
+    this->pollTimer = std::make_unique<QTimer>();
+    this->pollTimer->setInterval(pollInterval);
+    connect(this->pollTimer.get(), &QTimer::timeout, this, &Benchmark::pollMarkers);
+
+    // a page which never finishes loading or never becomes ready fails the run
+    this->runTimer = std::make_unique<QTimer>();
+    this->runTimer->setSingleShot(true);
+    this->runTimer->setInterval(runTimeout);
+    connect(this->runTimer.get(), &QTimer::timeout, this, [this]{
+        qWarning() << "benchmark: app didn't become ready within" << runTimeout << "ms";
+        this->finishRun(false);
+    });
+}
+
+Benchmark::~Benchmark()
+{
+    this->pollTimer->stop();
+    this->runTimer->stop();
+    this->page.reset();
+    delete this->coldProfile;
+}
+
+void Benchmark::start(const QUrl &url, int runs)
+{
+    this->url = url;
+    this->runs = runs;
+    this->phase = Phase::Cold;
+    this->currentRun = 0;
+    this->failed = false;
+    this->cold.clear();
+    this->warm.clear();
+    this->nextRun();
+}
+
+const QJsonObject Benchmark::report() const
+{
+    return {
+        {"url", this->url.toString()},
+        {"profile", this->profile->storageName()},
+        {"success", !this->failed},
+        {"cold", toJson(this->cold)},
+        {"warm", toJson(this->warm)},
+    };
+}
+
+void Benchmark::nextRun()
+{
+    // pages must be gone before their profile is deleted
+    this->page.reset();
+    delete this->coldProfile;
+    this->coldProfile = nullptr;
+
+    // the warm up consists of a single discarded run which populates the caches of the persistent profile
+    const auto phaseRuns = this->phase == Phase::WarmUp ? 1 : this->runs;
+
+    if (this->currentRun == phaseRuns)
+    {
+        this->currentRun = 0;
+
+        if (this->phase == Phase::Cold)
+        {
+            this->phase = Phase::WarmUp;
+        }
+        else if (this->phase == Phase::WarmUp)
+        {
+            this->phase = Phase::Warm;
+        }
+        else
+        {
+            emit finished(!this->failed);
+            return;
+        }
+    }
+
+    ++this->currentRun;
+    this->current = {};
+
+    auto profile = this->profile;
+    if (this->phase == Phase::Cold)
+    {
+        this->coldProfile = Benchmark::createColdProfile(this, this->handler);
+        profile = this->coldProfile;
+    }
+
+    this->page = std::make_unique<QWebEnginePage>(profile);
+    connect(this->page.get(), &QWebEnginePage::loadFinished, this, &Benchmark::loadFinished);
+
+    this->startTime = epochTime();
+    this->timer.start();
+    this->runTimer->start();
+    this->page->setUrl(this->url);
+}
+
+void Benchmark::requestHandled(const QUrl &)
+{
+    if (this->page && this->current.timeToFirstByte < 0)
+    {
+        this->current.timeToFirstByte = this->timer.nsecsElapsed() / 1e6;
+    }
+}
+
+void Benchmark::loadFinished(bool ok)
+{
+    // the run already timed out
+    if (!this->runTimer->isActive())
+    {
+        return;
+    }
+
+    if (!ok)
+    {
+        qWarning() << "benchmark: failed to load" << this->url;
+        this->finishRun(false);
+        return;
+    }
+
+    this->current.loadFinished = this->timer.nsecsElapsed() / 1e6;
+    this->pollTimer->start();
+}
+
+void Benchmark::pollMarkers()
+{
+    // skip this tick while the previous query is still pending
+    this->pollTimer->stop();
+
+    this->page->runJavaScript(queryScript, [this](const QVariant &result) {
+        // the run timed out while the query was pending
+        if (!this->runTimer->isActive())
+        {
+            return;
+        }
+
+        const auto markers = QJsonDocument::fromJson(result.toString().toUtf8()).object();
+
+        // the markers are relative to the time origin of the page, move them
+        // to the clock of the run which starts before the navigation
+        const auto origin = markers.value("origin");
+        const auto offset = origin.toDouble() - this->startTime;
+        const auto marker = [&](const char *name){
+            const auto value = markers.value(name);
+            return origin.isDouble() && value.isDouble() ? value.toDouble() + offset : -1;
+        };
+
+        this->current.firstPaint = marker("fp");
+        this->current.firstContentfulPaint = marker("fcp");
+        this->current.appReady = marker("ready");
+        this->current.serviceWorker = markers.value("serviceWorker").toBool();
+
+        if (this->current.appReady >= 0)
+        {
+            this->finishRun(true);
+        }
+        else
+        {
+            this->pollTimer->start();
+        }
+    });
+}
+
+void Benchmark::finishRun(bool success)
+{
+    this->pollTimer->stop();
+    this->runTimer->stop();
+
+    if (!success)
+    {
+        this->failed = true;
+    }
+
+    qDebug() << "benchmark run" << this->currentRun << "finished in" << this->timer.elapsed() << "ms";
+
+    if (this->phase == Phase::Cold)
+    {
+        this->cold.append(this->current);
+    }
+    else if (this->phase == Phase::Warm)
+    {
+        this->warm.append(this->current);
+    }
+
+    // don't delete the page from within one of its callbacks
+    QTimer::singleShot(0, this, &Benchmark::nextRun);
+}
+
+QWebEngineProfile *Benchmark::createColdProfile(QObject *parent, ElementUrlScheme *handler)
+{
+    // off-the-record profiles keep everything in memory and start empty
+    auto profile = new QWebEngineProfile(parent);
+    profile->installUrlSchemeHandler(ElementUrlScheme::schemeName(), handler);
+    UserScripts::install(profile);
+    return profile;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <QObject>
+#include <QUrl>
+#include <QList>
+#include <QJsonObject>
+#include <QElapsedTimer>
+
+#include <memory>
+
+class QWebEngineProfile;
+class QWebEnginePage;
+class QTimer;
+class ElementUrlScheme;
+
+/**
+ * Headless startup benchmark. Loads the webapp repeatedly, first with
+ * fresh off-the-record profiles (cold) and then with the given persistent
+ * profile (warm), and measures the time to interactive.
+ *
+ * All timings are in milliseconds since setUrl() of the run. The time to
+ * first byte and loadFinished are measured in the application, the paint
+ * and app ready markers of the page are moved from performance.timeOrigin
+ * to the same start using the wall clock both processes share.
+ */
+class Benchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Benchmark(QWebEngineProfile *profile, ElementUrlScheme *handler, QObject *parent = nullptr);
+    ~Benchmark();
+
+    struct Result
+    {
+        double timeToFirstByte = -1;
+        double loadFinished = -1;
+        double firstPaint = -1;
+        double firstContentfulPaint = -1;
+        double appReady = -1;
+
+        // the page was controlled by the service worker of element-web
+        bool serviceWorker = false;
+    };
+
+    void start(const QUrl &url, int runs);
+
+    /**
+     * Results and medians of all runs as JSON.
+     */
+    const QJsonObject report() const;
+
+signals:
+    void finished(bool success);
+
+private:
+    enum class Phase
+    {
+        Cold,
+        WarmUp,
+        Warm,
+    };
+
+    void nextRun();
+    void requestHandled(const QUrl &url);
+    void loadFinished(bool ok);
+    void pollMarkers();
+    void finishRun(bool success);
+
+    static QWebEngineProfile *createColdProfile(QObject *parent, ElementUrlScheme *handler);
+
+    QWebEngineProfile *profile;
+    ElementUrlScheme *handler;
+
+    std::unique_ptr<QWebEnginePage> page;
+    QWebEngineProfile *coldProfile = nullptr;
+    std::unique_ptr<QTimer> pollTimer;
+    std::unique_ptr<QTimer> runTimer;
+    QElapsedTimer timer;
+    double startTime = 0; // wall clock of timer.start()
+
+    QUrl url;
+    int runs = 0;
+    Phase phase = Phase::Cold;
+    int currentRun = 0;
+    bool failed = false;
+
+    Result current;
+    QList<Result> cold;
+    QList<Result> warm;
+};
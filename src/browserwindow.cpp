@@ -1,18 +1,49 @@
 #include "browserwindow.hpp"
-#include "globals.hpp"
-#include "paths.hpp"
 #include "desktopnotification.hpp"
+#include "userscripts.hpp"
+#include "trace.hpp"
+#include "globals.hpp"
+#include "diagnosticsdialog.hpp"
+#include "nativecrypto.hpp"
+#include "eventindex.hpp"
+#include "consolelog.hpp"
 
-#include <QSysInfo>
 #include <QShortcut>
 #include <QShowEvent>
 #include <QCloseEvent>
+#include <QResizeEvent>
 #include <QVariant>
+#include <QWebChannel>
+#include <QMessageBox>
+#include <QLabel>
+#include <QImageReader>
+#include <QSaveFile>
+#include <QGraphicsOpacityEffect>
+#include <QPropertyAnimation>
+#include <QtConcurrentRun>
+
+#include <algorithm>
+
+namespace
+{
+    // the snapshot is stored at most this wide, it is only shown until the app is ready
+    constexpr const int snapshotMaxWidth = 1280;
+    constexpr const int snapshotQuality = 75;
+
+    // how often the page is asked whether element-web is ready
+    constexpr const int appReadyPollInterval = 100;
 
-BrowserWindow::BrowserWindow(const QString &profileName, QWebEngineProfile *profile, QWidget *parent)
+    // a stale placeholder is worse than an empty window, even when the app isn't ready yet
+    constexpr const int placeholderTimeout = 30 * 1000;
+    constexpr const int placeholderFadeDuration = 200;
+}
+
+BrowserWindow::BrowserWindow(const QString &profileName, QWebEngineProfile *profile, ConfigManager *config, QWidget *parent)
     : QWidget(parent)
 {
+    this->_profileName = profileName;
     this->profile = profile;
+    this->config = config;
     this->setMinimumSize(250, 250);
 
     // retain size when hidden
@@ -41,10 +72,45 @@ BrowserWindow::BrowserWindow(const QString &profileName, QWebEngineProfile *prof
 
     webview->setContextMenuPolicy(Qt::NoContextMenu);
 
-    const auto path = paths->webEngineProfilePath(profileName);
-    this->profile->setCachePath(path);
-    this->profile->setPersistentStoragePath(QString("%1/%2").arg(path, "Storage"));
-    this->profile->setPersistentCookiesPolicy(QWebEngineProfile::AllowPersistentCookies);
+    // paint the last frame of the previous run until element-web is ready
+    const auto snapshotFile = QString("%1/%2").arg(paths->webEngineProfilePath(this->_profileName), "StartupSnapshot.jpg");
+    if (this->config->startupSnapshot())
+    {
+        this->snapshotFile = snapshotFile;
+        this->showPlaceholder();
+    }
+    else
+    {
+        QFile::remove(snapshotFile);
+    }
+
+    this->appReadyTimer = std::make_unique<QTimer>();
+    this->appReadyTimer->setInterval(appReadyPollInterval);
+    connect(this->appReadyTimer.get(), &QTimer::timeout, this, &BrowserWindow::pollAppReady);
+    connect(page, &QWebEnginePage::loadStarted, this, [&]{
+        this->appReady = false;
+        this->appReadyTimer->start();
+    });
+    connect(page, &QWebEnginePage::loadFinished, this, [&](bool ok){
+        if (!ok)
+        {
+            this->appReadyTimer->stop();
+            this->hidePlaceholder();
+        }
+    });
+    connect(qApp, &QCoreApplication::aboutToQuit, this, &BrowserWindow::saveSnapshot);
+
+    // console messages of the web app, read with --dump-console
+    if (this->config->diagnosticsConsoleLogEnabled())
+    {
+        const auto size = qint64(std::max(1, this->config->diagnosticsConsoleLogSize())) * 1024 * 1024;
+        this->consoleLog = std::make_unique<ConsoleLog>(QString("%1/%2").arg(paths->webEngineProfilePath(this->_profileName), "ConsoleLog"), size);
+        if (this->consoleLog->open())
+        {
+            page->setConsoleLog(this->consoleLog.get());
+        }
+    }
+
     this->profile->setNotificationPresenter([&](std::unique_ptr<QWebEngineNotification> notification){
         qDebug() << "notification received:" << notification->title() << notification->message();
         this->_notification = notification.get();
@@ -81,11 +147,6 @@ BrowserWindow::BrowserWindow(const QString &profileName, QWebEngineProfile *prof
     });
     this->initializeScripts();
 
-    // add application to user agent
-    auto useragent = this->profile->httpUserAgent();
-    useragent.append(QString(" %1/%2").arg(qApp->applicationName(), qApp->applicationVersion()));
-    this->profile->setHttpUserAgent(useragent);
-
     settings->setAttribute(QWebEngineSettings::PluginsEnabled, true);
     settings->setAttribute(QWebEngineSettings::FullScreenSupportEnabled, true);
     settings->setAttribute(QWebEngineSettings::ScreenCaptureEnabled, true);
@@ -100,13 +161,52 @@ BrowserWindow::BrowserWindow(const QString &profileName, QWebEngineProfile *prof
     connect(page, &QWebEnginePage::fullScreenRequested, this, &BrowserWindow::acceptFullScreen);
     connect(page, &QWebEnginePage::featurePermissionRequested, this, &BrowserWindow::acceptFeaturePermission);
     connect(page, &QWebEnginePage::loadFinished, this, &BrowserWindow::setupNetworkMonitor);
+#ifdef STARTUP_TRACING_ENABLED
+    connect(page, &QWebEnginePage::loadFinished, this, []{
+        TRACE_INSTANT("loadFinished");
+    });
+#endif
+
+    const auto webChannel = [this]{
+        if (!this->webChannel)
+        {
+            this->webChannel = std::make_unique<QWebChannel>();
+        }
+        return this->webChannel.get();
+    };
+
+#ifdef NATIVE_CRYPTO_ENABLED
+    // offload megolm decryption to native threads, the page keeps the wasm fallback
+    if (this->config->cryptoNativeEnabled())
+    {
+        qInfo() << "native decryption is experimental, element-web must be patched to call window.qelementCrypto";
+        this->nativeCrypto = std::make_unique<NativeCrypto>();
+        webChannel()->registerObject(NativeCrypto::channelName(), this->nativeCrypto.get());
+        UserScripts::installNativeCrypto(this->profile);
+    }
+#endif
+
+    // search in encrypted rooms, element-web only uses the index when enabled in its settings
+    if (this->config->searchEventIndexEnabled())
+    {
+        this->eventIndex = std::make_unique<EventIndex>(QString("%1/%2").arg(paths->webEngineProfilePath(this->_profileName), "EventIndex"));
+        webChannel()->registerObject(EventIndex::channelName(), this->eventIndex.get());
+        UserScripts::installEventIndex(this->profile);
+    }
+
+    if (this->webChannel)
+    {
+        page->setWebChannel(this->webChannel.get(), QWebEngineScript::MainWorld);
+    }
 
     page->setUrl(QUrl("element://localhost/"));
 
     // create system tray icon with notification support
-    if (QSystemTrayIcon::isSystemTrayAvailable() && config->sysTrayIconEnabled())
+    if (QSystemTrayIcon::isSystemTrayAvailable() && this->config->sysTrayIconEnabled())
     {
         this->trayIcon = std::make_unique<QSystemTrayIcon>();
+        this->trayToolTip = qApp->applicationDisplayName();
+        this->trayIcon->setToolTip(this->trayToolTip);
         this->setNotificationIcon(NotificationIcon::Normal);
 
         this->trayMenu = std::make_unique<QMenu>();
@@ -114,6 +214,10 @@ BrowserWindow::BrowserWindow(const QString &profileName, QWebEngineProfile *prof
             this->trayTriggerCallback(QSystemTrayIcon::Trigger);
         });
         trayMenu->addSeparator();
+        if (watchdog)
+        {
+            trayMenu->addAction(tr("Diagnostics"), this, &BrowserWindow::showDiagnostics);
+        }
         trayMenu->addAction(tr("Quit %1").arg(qApp->applicationDisplayName()), this, []{
             qApp->quit();
         });
@@ -144,34 +248,19 @@ BrowserWindow::BrowserWindow(const QString &profileName, QWebEngineProfile *prof
     this->networkMonitorTimer->start();
 
     // setup downloader
-    connect(this->profile, &QWebEngineProfile::downloadRequested, this, [&](QWebEngineDownloadRequest *download) {
-        const auto filename = QFileDialog::getSaveFileName(this, tr("Download"), QDir::homePath());
-
-        if (filename.isEmpty())
-        {
-            download->cancel();
-            return;
-        }
-
-        const auto fileinfo = QFileInfo(filename);
-
-        download->setDownloadDirectory(fileinfo.path());
-        download->setDownloadFileName(fileinfo.fileName());
-
-        connect(download, &QWebEngineDownloadRequest::isFinishedChanged, this, [&]{
-            // send notification using libnotify when enabled
+    this->downloadManager = std::make_unique<DownloadManager>(this->config, this);
+    connect(this->profile, &QWebEngineProfile::downloadRequested, this->downloadManager.get(), &DownloadManager::requested);
+    connect(this->downloadManager.get(), &DownloadManager::changed, this, &BrowserWindow::updateDownloads);
+    connect(this->downloadManager.get(), &DownloadManager::finished, this, [](QWebEngineDownloadRequest *download){
+        // send notification using libnotify when enabled
 #ifdef LIBNOTIFY_ENABLED
-            DesktopNotification::send(
-                qApp->applicationDisplayName(),
-                tr("Download finished"),
-                qApp->windowIcon().pixmap(128, 128).toImage());
+        DesktopNotification::send(
+            qApp->applicationDisplayName(),
+            tr("Download finished: %1").arg(download->downloadFileName()),
+            qApp->windowIcon().pixmap(128, 128).toImage());
+#else
+        Q_UNUSED(download);
 #endif
-        });
-
-        // connect(download, &QWebEngineDownloadRequest::downloadProgress, this, [&](qint64 bytesReceived, qint64 bytesTotal) {
-        // });
-
-        download->accept();
     });
 
     // setup shortcuts
@@ -189,9 +278,313 @@ BrowserWindow::BrowserWindow(const QString &profileName, QWebEngineProfile *prof
             });
 }
 
+const QString &BrowserWindow::profileName() const
+{
+    return this->_profileName;
+}
+
+void BrowserWindow::setProfileWindows(const QList<BrowserWindow*> &windows)
+{
+    if (!this->trayIcon || windows.size() < 2)
+    {
+        return;
+    }
+
+    // identify the profile of this tray icon
+    this->trayToolTip = QString("%1 - %2").arg(qApp->applicationDisplayName(), this->_profileName);
+    this->trayIcon->setToolTip(this->trayToolTip);
+
+    // menu to switch to the window of another profile
+    if (!this->profilesMenu)
+    {
+        this->profilesMenu = std::make_unique<QMenu>(tr("Profiles"));
+        trayMenu->insertMenu(trayMenu->actions().at(1), this->profilesMenu.get());
+    }
+
+    this->profilesMenu->clear();
+    for (auto&& window : windows)
+    {
+        auto action = this->profilesMenu->addAction(window->profileName(), window, &BrowserWindow::activate);
+        action->setCheckable(true);
+        action->setChecked(window == this);
+    }
+}
+
 BrowserWindow::~BrowserWindow()
 {
     this->networkMonitorTimer->stop();
+    this->appReadyTimer->stop();
+    page->setConsoleLog(nullptr);
+
+    // the snapshot written on exit must be complete
+    this->snapshotWriter.waitForFinished();
+
+    // the web channel is deleted before the page
+    if (this->webChannel)
+    {
+        page->setWebChannel(nullptr);
+    }
+}
+
+void BrowserWindow::showDiagnostics()
+{
+    if (!this->diagnosticsDialog)
+    {
+        this->diagnosticsDialog = std::make_unique<DiagnosticsDialog>(watchdog);
+    }
+
+    this->diagnosticsDialog->refresh();
+    this->diagnosticsDialog->show();
+    this->diagnosticsDialog->raise();
+    this->diagnosticsDialog->activateWindow();
+}
+
+void BrowserWindow::showPlaceholder()
+{
+    QImageReader reader(this->snapshotFile);
+    const auto image = reader.read();
+    if (image.isNull())
+    {
+        return;
+    }
+
+    this->placeholder = std::make_unique<QLabel>(this);
+    this->placeholder->setScaledContents(true);
+    this->placeholder->setPixmap(QPixmap::fromImage(image));
+    this->placeholder->setGeometry(this->rect());
+    this->placeholder->raise();
+    this->placeholder->show();
+
+    QTimer::singleShot(placeholderTimeout, this, &BrowserWindow::hidePlaceholder);
+}
+
+void BrowserWindow::hidePlaceholder()
+{
+    // already fading out
+    if (!this->placeholder || this->placeholder->graphicsEffect())
+    {
+        return;
+    }
+
+    // cross-fade to the live view underneath
+    auto effect = new QGraphicsOpacityEffect(this->placeholder.get());
+    this->placeholder->setGraphicsEffect(effect);
+    auto animation = new QPropertyAnimation(effect, "opacity", this->placeholder.get());
+    animation->setDuration(placeholderFadeDuration);
+    animation->setStartValue(1.0);
+    animation->setEndValue(0.0);
+    connect(animation, &QPropertyAnimation::finished, this, [&]{
+        this->placeholder.release()->deleteLater();
+    });
+    animation->start();
+}
+
+void BrowserWindow::pollAppReady()
+{
+    page->runJavaScript("window.__qelement_app_ready !== undefined;", [&](const QVariant &result) {
+        if (!this->appReady && result.toBool())
+        {
+            this->appReady = true;
+            this->appReadyTimer->stop();
+            this->hidePlaceholder();
+        }
+    });
+}
+
+void BrowserWindow::saveSnapshot()
+{
+    // only frames of the ready app are worth painting on the next start
+    if (this->snapshotFile.isEmpty() || !this->appReady || this->placeholder || !this->isVisible() || this->isMinimized())
+    {
+        return;
+    }
+
+    const auto image = webview->grab().toImage();
+    if (image.isNull())
+    {
+        return;
+    }
+
+    // scaling and encoding take longer than the grab, a newer frame replaces the previous one
+    this->snapshotWriter.waitForFinished();
+    this->snapshotWriter = QtConcurrent::run(&BrowserWindow::writeSnapshot, image, this->snapshotFile);
+}
+
+void BrowserWindow::writeSnapshot(const QImage &image, const QString &file)
+{
+    auto scaled = image;
+    scaled.setDevicePixelRatio(1);
+    const auto width = std::min(snapshotMaxWidth, int(image.width() / image.devicePixelRatio()));
+    if (scaled.width() > width)
+    {
+        scaled = scaled.scaledToWidth(width, Qt::SmoothTransformation);
+    }
+
+    // the snapshot shows the messages of the user
+    QSaveFile output(file);
+    if (!output.open(QIODevice::WriteOnly) ||
+        !output.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner) ||
+        !scaled.convertToFormat(QImage::Format_RGB32).save(&output, "JPG", snapshotQuality) ||
+        !output.commit())
+    {
+        qWarning() << "unable to write the startup snapshot:" << file << output.errorString();
+    }
+}
+
+void BrowserWindow::offerReload(const QString &version)
+{
+    if (!this->reloadDialog)
+    {
+        this->reloadDialog = std::make_unique<QMessageBox>(this);
+        this->reloadDialog->setIcon(QMessageBox::Information);
+        this->reloadDialog->setWindowTitle(qApp->applicationDisplayName());
+        this->reloadDialog->setStandardButtons(QMessageBox::Yes | QMessageBox::No);
+        this->reloadDialog->setDefaultButton(QMessageBox::Yes);
+        this->reloadDialog->button(QMessageBox::Yes)->setText(tr("Reload"));
+        this->reloadDialog->button(QMessageBox::No)->setText(tr("Later"));
+        connect(this->reloadDialog.get(), &QMessageBox::buttonClicked, this, [&](QAbstractButton *button){
+            if (this->reloadDialog->standardButton(button) == QMessageBox::Yes)
+            {
+                webview->triggerPageAction(QWebEnginePage::Reload);
+            }
+        });
+    }
+
+    // a later version replaces the text of a dialog which is still open
+    this->reloadDialog->setText(tr("Element %1 is ready. Reload to start using it?").arg(version));
+    this->reloadDialog->open();
+}
+
+void BrowserWindow::activate()
+{
+    if (!this->isVisible())
+    {
+        this->restoreGeometry(this->_geometry);
+    }
+
+    this->showNormal();
+    this->raise();
+    this->activateWindow();
+    this->updateShowHideMenuAction();
+}
+
+void BrowserWindow::openUrl(const QUrl &url)
+{
+    // element:// urls are opened as is
+    if (url.scheme() == "element")
+    {
+        page->setUrl(url);
+        return;
+    }
+
+    // translate matrix.to permalinks into element-web routes
+    //   https://matrix.to/#/@user:server            -> #/user/@user:server
+    //   https://matrix.to/#/!room:server/$event     -> #/room/!room:server/$event
+    //   https://matrix.to/#/#alias:server?via=x     -> #/room/#alias:server?via=x
+    if (url.host() == "matrix.to")
+    {
+        auto target = url.fragment(QUrl::FullyEncoded);
+        if (target.startsWith('/'))
+        {
+            target.remove(0, 1);
+        }
+
+        if (target.isEmpty())
+        {
+            return;
+        }
+
+        const auto decoded = QUrl::fromPercentEncoding(target.toUtf8());
+        const QString route = decoded.startsWith('@') ? "user" : "room";
+        page->setUrl(QUrl(QString("element://localhost/#/%1/%2").arg(route, target), QUrl::TolerantMode));
+        return;
+    }
+
+    qDebug() << "ignoring unsupported url:" << url;
+}
+
+void BrowserWindow::updateDownloads()
+{
+    if (!this->trayIcon)
+    {
+        return;
+    }
+
+    // aggregated progress and speed
+    const auto summary = this->downloadManager->summary();
+    this->trayIcon->setToolTip(summary.isEmpty() ? this->trayToolTip : QString("%1\n%2").arg(this->trayToolTip, summary));
+
+    // menu with the active downloads, each entry pauses or resumes the download
+    if (!this->downloadsMenu)
+    {
+        this->downloadsMenu = std::make_unique<QMenu>(tr("Downloads"));
+        trayMenu->insertMenu(trayMenu->actions().at(1), this->downloadsMenu.get());
+    }
+
+    // the menu is only rebuilt when downloads come or go, otherwise the texts are updated in place
+    // so an open menu doesn't flicker and keeps the action under the cursor
+    QList<quint32> ids;
+    for (auto&& [id, download] : this->downloadManager->downloads())
+    {
+        if (download.request)
+        {
+            ids.append(id);
+        }
+    }
+
+    if (ids != this->downloadActions.keys())
+    {
+        this->downloadsMenu->clear();
+        this->downloadActions.clear();
+        for (auto&& id : ids)
+        {
+            const auto downloadId = id;
+            this->downloadActions.insert(id, this->downloadsMenu->addAction({}, this, [this, downloadId]{
+                const auto &downloads = this->downloadManager->downloads();
+                const auto it = downloads.find(downloadId);
+                if (it != downloads.end())
+                {
+                    it->second.pausedByUser ? this->downloadManager->resume(downloadId) : this->downloadManager->pause(downloadId);
+                }
+            }));
+        }
+    }
+    this->downloadsMenu->menuAction()->setVisible(!this->downloadManager->downloads().empty());
+
+    const QLocale locale;
+    for (auto&& [id, download] : this->downloadManager->downloads())
+    {
+        if (!download.request)
+        {
+            continue;
+        }
+
+        const auto total = download.request->totalBytes();
+        const auto received = download.request->receivedBytes();
+        const auto progress = total > 0 ? QString("%1%").arg(received * 100 / total) : locale.formattedDataSize(received);
+
+        QString status;
+        if (download.pausedByUser)
+        {
+            status = tr("paused");
+        }
+        else if (download.queued)
+        {
+            status = tr("queued");
+        }
+        else
+        {
+            const auto speed = download.throughput.isEmpty() ? 0 : download.throughput.last();
+            status = tr("%1/s").arg(locale.formattedDataSize(qint64(speed)));
+        }
+
+        const auto text = QString("%1 - %2 (%3)").arg(download.request->downloadFileName(), progress, status);
+        auto action = this->downloadActions.value(id);
+        if (action->text() != text)
+        {
+            action->setText(text);
+        }
+    }
 }
 
 void BrowserWindow::setNotificationIcon(NotificationIcon icon)
@@ -293,12 +686,14 @@ void BrowserWindow::closeEvent(QCloseEvent *event)
     {
         // if tray icon is present, close the window instead of exiting the application
         this->_geometry = this->saveGeometry();
+        this->saveSnapshot();
         this->hide();
         this->updateShowHideMenuAction();
     }
     else
     {
         // exit the application when no tray icon is present
+        this->saveSnapshot();
         event->accept();
     }
 }
@@ -322,6 +717,16 @@ bool BrowserWindow::event(QEvent *event)
     return QWidget::event(event);
 }
 
+void BrowserWindow::resizeEvent(QResizeEvent *event)
+{
+    if (this->placeholder)
+    {
+        this->placeholder->setGeometry(this->rect());
+    }
+
+    QWidget::resizeEvent(event);
+}
+
 void BrowserWindow::trayTriggerCallback(QSystemTrayIcon::ActivationReason reason)
 {
     if (reason == QSystemTrayIcon::Trigger)
@@ -329,6 +734,7 @@ void BrowserWindow::trayTriggerCallback(QSystemTrayIcon::ActivationReason reason
         if (this->isVisible())
         {
             this->_geometry = this->saveGeometry();
+            this->saveSnapshot();
             this->hide();
         }
         else
@@ -361,71 +767,7 @@ void BrowserWindow::updateShowHideMenuAction()
 
 void BrowserWindow::initializeScripts()
 {
-    auto scripts = profile->scripts();
-
-    // script to get the homeserver url for network monitor
-    QWebEngineScript homeserverUrlGetter;
-    homeserverUrlGetter.setName("homeserver-url-getter");
-    homeserverUrlGetter.setWorldId(QWebEngineScript::MainWorld);
-    homeserverUrlGetter.setInjectionPoint(QWebEngineScript::Deferred);
-    homeserverUrlGetter.setSourceCode(R"(window.mx_hs_url = localStorage.getItem("mx_hs_url");)");
-
-    // notifications are reset to disabled on every app restart and reload for some unknown reason
-    QWebEngineScript notificationFixer;
-    notificationFixer.setName("notification-fixer");
-    notificationFixer.setWorldId(QWebEngineScript::MainWorld);
-    notificationFixer.setInjectionPoint(QWebEngineScript::Deferred);
-    notificationFixer.setSourceCode(R"(
-        console.info("fixing notifications...");
-        let notification_fixer = () => {
-            try { mxSettingsStore.setValue("notificationsEnabled", null, "device", true); } catch (e){}
-            try { mxSettingsStore.setValue("notificationBodyEnabled", null, "device", true); } catch (e){}
-            try { mxSettingsStore.setValue("audioNotificationsEnabled", null, "device", true); } catch (e){}
-        };
-        // run snippet 3 times to make absolutely sure, sometimes the setting doesn't apply
-        setTimeout(notification_fixer, 2000);
-        setTimeout(notification_fixer, 3000);
-        setTimeout(notification_fixer, 4000);
-    )");
-
-    // manipulate the device name function to return a proper name instead of a ugly url
-    QWebEngineScript deviceName;
-    deviceName.setName("device-name");
-    deviceName.setWorldId(QWebEngineScript::MainWorld);
-    deviceName.setInjectionPoint(QWebEngineScript::Deferred);
-    deviceName.setSourceCode(QString(R"###(
-        console.info("setting custom device name...");
-        let device_name = () => {
-            try {
-                mxPlatformPeg.platform.getDefaultDeviceDisplayName = function() {
-                    return "%1 (%2)";
-                };
-            } catch (e) {}
-        };
-        device_name();
-        setTimeout(device_name, 1000);
-        setTimeout(device_name, 2000);
-        setTimeout(device_name, 3000);
-        setTimeout(device_name, 4000);
-    )###").arg(qApp->applicationDisplayName(), QSysInfo::prettyProductName()));
-
-    if (!scripts->contains(homeserverUrlGetter))
-    {
-        qDebug() << "install homeserver url getter script...";
-        scripts->insert(homeserverUrlGetter);
-    }
-
-    if (!scripts->contains(notificationFixer))
-    {
-        qDebug() << "install notification fixer script...";
-        scripts->insert(notificationFixer);
-    }
-
-    if (!scripts->contains(deviceName))
-    {
-        qDebug() << "install device name script...";
-        scripts->insert(deviceName);
-    }
+    UserScripts::install(profile);
 }
 
 void BrowserWindow::setupNetworkMonitor(bool ok)
@@ -6,19 +6,45 @@
 #include <QtWebEngineWidgets>
 #include <QSystemTrayIcon>
 #include <QNetworkAccessManager>
+#include <QFuture>
+#include <QMap>
 
 #include "webengineview.hpp"
+#include "configmanager.hpp"
+#include "downloadmanager.hpp"
 
 #include <memory>
 
+class DiagnosticsDialog;
+class NativeCrypto;
+class EventIndex;
+class QWebChannel;
+class QMessageBox;
+class ConsoleLog;
+class QLabel;
+
 class BrowserWindow : public QWidget
 {
     Q_OBJECT
 
 public:
-    explicit BrowserWindow(const QString &profileName, QWebEngineProfile *profile, QWidget *parent = nullptr);
+    explicit BrowserWindow(const QString &profileName, QWebEngineProfile *profile, ConfigManager *config, QWidget *parent = nullptr);
     ~BrowserWindow();
 
+    const QString &profileName() const;
+
+    // shows and raises the window, also when it was hidden to the tray
+    void activate();
+
+    // opens an element:// or matrix.to url in the webapp
+    void openUrl(const QUrl &url);
+
+    // adds a menu to the tray icon to switch between the windows of all profiles in this process
+    void setProfileWindows(const QList<BrowserWindow*> &windows);
+
+    // asks to reload the page when a new version of the web app is ready
+    void offerReload(const QString &version);
+
     enum class NotificationIcon
     {
         NoIcon          = -1,
@@ -40,6 +66,7 @@ protected:
     void showEvent(QShowEvent *event);
     void closeEvent(QCloseEvent *event);
     bool event(QEvent *event);
+    void resizeEvent(QResizeEvent *event);
 
 private:
     std::unique_ptr<QHBoxLayout> _layout;
@@ -48,18 +75,33 @@ private:
 
     std::unique_ptr<QSystemTrayIcon> trayIcon;
     std::unique_ptr<QMenu> trayMenu;
+    std::unique_ptr<QMenu> profilesMenu;
+    std::unique_ptr<QMenu> downloadsMenu;
+    QMap<quint32, QAction*> downloadActions;
+    QString trayToolTip;
 
     // convenience pointers for web view
     WebEngineView *webview;
     WebEnginePage *page;
     QWebEngineSettings *settings;
     QWebEngineProfile *profile;
+    ConfigManager *config;
+    QString _profileName;
 
     void trayTriggerCallback(QSystemTrayIcon::ActivationReason reason);
     void updateShowHideMenuAction();
     void initializeScripts();
     void setupNetworkMonitor(bool ok);
     void updateNetworkState(QNetworkReply *reply);
+    void updateDownloads();
+    void showDiagnostics();
+
+    // last frame of the web app, painted on startup until element-web is ready
+    void showPlaceholder();
+    void hidePlaceholder();
+    void pollAppReady();
+    void saveSnapshot();
+    static void writeSnapshot(const QImage &image, const QString &file);
 
     NotificationIcon _notificationIcon = NotificationIcon::NoIcon;
     bool _hasNotification = false;
@@ -68,4 +110,22 @@ private:
     QString homeserver;
     std::unique_ptr<QNetworkAccessManager> networkMonitor;
     std::unique_ptr<QTimer> networkMonitorTimer;
+
+    std::unique_ptr<DownloadManager> downloadManager;
+    std::unique_ptr<DiagnosticsDialog> diagnosticsDialog;
+    std::unique_ptr<QMessageBox> reloadDialog;
+    std::unique_ptr<ConsoleLog> consoleLog;
+
+    QString snapshotFile;
+    std::unique_ptr<QLabel> placeholder;
+    std::unique_ptr<QTimer> appReadyTimer;
+    bool appReady = false;
+    QFuture<void> snapshotWriter;
+
+    // native objects for the page, the channel only exists when one is enabled
+#ifdef NATIVE_CRYPTO_ENABLED
+    std::unique_ptr<NativeCrypto> nativeCrypto;
+#endif
+    std::unique_ptr<EventIndex> eventIndex;
+    std::unique_ptr<QWebChannel> webChannel;
 };
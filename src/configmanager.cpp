@@ -1,26 +1,122 @@
 #include "configmanager.hpp"
 
-#include <unordered_map>
+#include <QFileSystemWatcher>
+#include <QFileInfo>
+#include <QTimer>
+#include <QDebug>
 
-struct KeyValuePair
+#include <type_traits>
+
+namespace {
+
+// compile-time schema, every key has a settings name, a typed default
+// and the member of the snapshot holding its value
+template<ConfigManager::Key K>
+struct KeyTraits;
+
+#define CONFIG_KEY(KEY, NAME, MEMBER, DEFAULT) \
+    template<> \
+    struct KeyTraits<ConfigManager::Key::KEY> \
+    { \
+        using type = decltype(ConfigManager::Snapshot::MEMBER); \
+        static constexpr const ConfigManager::Key key = ConfigManager::Key::KEY; \
+        static constexpr const char *name = NAME; \
+        static constexpr auto member = &ConfigManager::Snapshot::MEMBER; \
+        static const type defaultValue() { return DEFAULT; } \
+    };
+
+CONFIG_KEY(Webroot,                    "element/webroot",             webroot,                    QString("/opt/Element/resources/webapp"))
+CONFIG_KEY(OptimizeIndex,              "element/optimizeIndex",       optimizeIndex,              true)
+CONFIG_KEY(ServiceWorker,              "element/serviceWorker",       serviceWorker,              false)
+CONFIG_KEY(SysTrayIconEnabled,         "app/sysTrayIconEnabled",      sysTrayIconEnabled,         true)
+CONFIG_KEY(StartupSnapshot,            "app/startupSnapshot",         startupSnapshot,            true)
+
+CONFIG_KEY(EnginePreset,               "engine/preset",               enginePreset,               QString("default"))
+CONFIG_KEY(EngineProcessModel,         "engine/processModel",         engineProcessModel,         QString("default"))
+CONFIG_KEY(EngineRendererProcessLimit, "engine/rendererProcessLimit", engineRendererProcessLimit, 0)
+CONFIG_KEY(EngineJsHeapLimit,          "engine/jsHeapLimit",          engineJsHeapLimit,          0)
+CONFIG_KEY(EngineRasterThreads,        "engine/rasterThreads",        engineRasterThreads,        0)
+CONFIG_KEY(EngineGpuCompositing,       "engine/gpuCompositing",       engineGpuCompositing,       true)
+CONFIG_KEY(EngineHttpCacheSize,        "engine/httpCacheSize",        engineHttpCacheSize,        0)
+
+CONFIG_KEY(DownloadsMaxConcurrent,     "downloads/maxConcurrent",     downloadsMaxConcurrent,     3)
+CONFIG_KEY(DownloadsAskForLocation,    "downloads/askForLocation",    downloadsAskForLocation,    true)
+CONFIG_KEY(DownloadsLastDirectory,     "downloads/lastDirectory",     downloadsLastDirectory,     QString())
+
+CONFIG_KEY(MediaCacheEnabled,          "media/cacheEnabled",          mediaCacheEnabled,          false)
+CONFIG_KEY(MediaCacheSize,             "media/cacheSize",             mediaCacheSize,             512)
+
+CONFIG_KEY(NetworkMonitorEnabled,      "network/monitorEnabled",      networkMonitorEnabled,      false)
+CONFIG_KEY(NetworkMonitorInterval,     "network/monitorInterval",     networkMonitorInterval,     60)
+
+CONFIG_KEY(CacheType,                  "cache/type",                  cacheType,                  QString("disk"))
+CONFIG_KEY(CacheLocation,              "cache/location",              cacheLocation,              QString())
+CONFIG_KEY(CacheWriteBack,             "cache/writeBack",             cacheWriteBack,             false)
+CONFIG_KEY(CacheWriteBackSize,         "cache/writeBackSize",         cacheWriteBackSize,         64)
+
+CONFIG_KEY(DiagnosticsWatchdogEnabled, "diagnostics/watchdogEnabled", diagnosticsWatchdogEnabled, true)
+CONFIG_KEY(DiagnosticsStallThreshold,  "diagnostics/stallThreshold",  diagnosticsStallThreshold,  500)
+CONFIG_KEY(DiagnosticsStackCapture,    "diagnostics/stackCapture",    diagnosticsStackCapture,    false)
+CONFIG_KEY(DiagnosticsConsoleLogEnabled, "diagnostics/consoleLogEnabled", diagnosticsConsoleLogEnabled, true)
+CONFIG_KEY(DiagnosticsConsoleLogSize,  "diagnostics/consoleLogSize",  diagnosticsConsoleLogSize,  4)
+
+CONFIG_KEY(CryptoNativeEnabled,        "crypto/nativeEnabled",        cryptoNativeEnabled,        false)
+
+CONFIG_KEY(SearchEventIndexEnabled,    "search/eventIndexEnabled",    searchEventIndexEnabled,    false)
+
+CONFIG_KEY(LogSink,                    "log/sink",                    logSink,                    QString("console"))
+CONFIG_KEY(LogFileSize,                "log/fileSize",                logFileSize,                10)
+CONFIG_KEY(LogFiles,                   "log/files",                   logFiles,                   5)
+
+#undef CONFIG_KEY
+
+template<ConfigManager::Key... Keys>
+struct KeyList
 {
-    const QString key;
-    const QVariant value;
+    template<typename Function>
+    static void forEach(Function &&function)
+    {
+        (function(KeyTraits<Keys>{}), ...);
+    }
 };
 
-static const std::unordered_map<ConfigManager::Key, KeyValuePair> definitions = {
-    {ConfigManager::Key::Webroot,            {"element/webroot",        QString("/opt/Element/resources/webapp")}},
-    {ConfigManager::Key::SysTrayIconEnabled, {"app/sysTrayIconEnabled", bool(true)}},
-};
+using Schema = KeyList<
+    ConfigManager::Key::Webroot,
+    ConfigManager::Key::OptimizeIndex,
+    ConfigManager::Key::ServiceWorker,
+    ConfigManager::Key::SysTrayIconEnabled,
+    ConfigManager::Key::StartupSnapshot,
+    ConfigManager::Key::EnginePreset,
+    ConfigManager::Key::EngineProcessModel,
+    ConfigManager::Key::EngineRendererProcessLimit,
+    ConfigManager::Key::EngineJsHeapLimit,
+    ConfigManager::Key::EngineRasterThreads,
+    ConfigManager::Key::EngineGpuCompositing,
+    ConfigManager::Key::EngineHttpCacheSize,
+    ConfigManager::Key::DownloadsMaxConcurrent,
+    ConfigManager::Key::DownloadsAskForLocation,
+    ConfigManager::Key::DownloadsLastDirectory,
+    ConfigManager::Key::MediaCacheEnabled,
+    ConfigManager::Key::MediaCacheSize,
+    ConfigManager::Key::NetworkMonitorEnabled,
+    ConfigManager::Key::NetworkMonitorInterval,
+    ConfigManager::Key::CacheType,
+    ConfigManager::Key::CacheLocation,
+    ConfigManager::Key::CacheWriteBack,
+    ConfigManager::Key::CacheWriteBackSize,
+    ConfigManager::Key::DiagnosticsWatchdogEnabled,
+    ConfigManager::Key::DiagnosticsStallThreshold,
+    ConfigManager::Key::DiagnosticsStackCapture,
+    ConfigManager::Key::DiagnosticsConsoleLogEnabled,
+    ConfigManager::Key::DiagnosticsConsoleLogSize,
+    ConfigManager::Key::CryptoNativeEnabled,
+    ConfigManager::Key::SearchEventIndexEnabled,
+    ConfigManager::Key::LogSink,
+    ConfigManager::Key::LogFileSize,
+    ConfigManager::Key::LogFiles
+>;
 
-static inline const decltype(KeyValuePair::key) keyName(const ConfigManager::Key &key)
-{
-    return definitions.at(key).key;
-}
-static inline const decltype(KeyValuePair::value) value(const ConfigManager::Key &key)
-{
-    return definitions.at(key).value;
-}
+} // anonymous namespace
 
 ConfigManager::ConfigManager(const QString &baseLocation, QObject *parent)
     : QObject(parent)
@@ -28,42 +124,285 @@ ConfigManager::ConfigManager(const QString &baseLocation, QObject *parent)
     const auto file = QString("%1/%2").arg(baseLocation, "preferences.ini");
     this->settings = std::make_unique<QSettings>(file, QSettings::IniFormat, this);
 
-    // initialize defaults
-    this->initialize_key(Key::Webroot);
-    this->initialize_key(Key::SysTrayIconEnabled);
+    // initialize defaults, only write the file when keys are missing
+    bool missing = false;
+    Schema::forEach([&](auto traits){
+        using Traits = decltype(traits);
+        if (!this->settings->contains(Traits::name))
+        {
+            this->settings->setValue(Traits::name, Traits::defaultValue());
+            missing = true;
+        }
+    });
+    if (missing)
+    {
+        this->settings->sync();
+    }
+
+    this->_snapshot = std::make_shared<const Snapshot>(this->read());
 }
 
-void ConfigManager::initialize_key(const Key &key)
+ConfigManager::~ConfigManager()
 {
-    if (!this->settings->contains(keyName(key)))
+    this->settings->sync();
+}
+
+void ConfigManager::startWatching()
+{
+    if (this->watcher)
     {
-        this->settings->setValue(keyName(key), value(key));
+        return;
     }
+
+    // apply external edits of the preferences
+    this->watcher = std::make_unique<QFileSystemWatcher>();
+    this->watcher->addPath(this->settings->fileName());
+    connect(this->watcher.get(), &QFileSystemWatcher::fileChanged, this, &ConfigManager::reload);
 }
 
-ConfigManager::~ConfigManager()
+std::shared_ptr<const ConfigManager::Snapshot> ConfigManager::snapshot() const
+{
+    return this->_snapshot;
+}
+
+template<ConfigManager::Key K, typename T>
+void ConfigManager::set(const T &value)
+{
+    using Traits = KeyTraits<K>;
+    static_assert(std::is_same_v<T, typename Traits::type>, "value doesn't match the type of the key");
+
+    this->settings->setValue(Traits::name, value);
+
+    auto snapshot = std::make_shared<Snapshot>(*this->_snapshot);
+    (*snapshot).*Traits::member = value;
+    this->_snapshot = std::move(snapshot);
+
+    emit configUpdated(K);
+}
+
+const ConfigManager::Snapshot ConfigManager::read() const
+{
+    Snapshot snapshot;
+    Schema::forEach([&](auto traits){
+        using Traits = decltype(traits);
+        const auto value = this->settings->value(Traits::name);
+        snapshot.*Traits::member = value.isValid() ? value.template value<typename Traits::type>() : Traits::defaultValue();
+    });
+    return snapshot;
+}
+
+void ConfigManager::reload()
 {
+    const auto file = this->settings->fileName();
+
+    // editors and QSettings itself replace the file, which drops it from the watcher
+    if (!QFileInfo::exists(file))
+    {
+        QTimer::singleShot(100, this, &ConfigManager::reload);
+        return;
+    }
+    if (!this->watcher->files().contains(file))
+    {
+        this->watcher->addPath(file);
+    }
+
     this->settings->sync();
+    if (this->settings->status() != QSettings::NoError)
+    {
+        qWarning() << "config: ignoring invalid preferences file" << file;
+        return;
+    }
+
+    const auto previous = this->_snapshot;
+    this->_snapshot = std::make_shared<const Snapshot>(this->read());
+
+    // our own writes end up here too, but don't change the snapshot
+    Schema::forEach([&](auto traits){
+        using Traits = decltype(traits);
+        if (!((*previous).*Traits::member == (*this->_snapshot).*Traits::member))
+        {
+            qDebug() << "config: reloaded" << Traits::name;
+            emit configUpdated(Traits::key);
+        }
+    });
 }
 
 void ConfigManager::setWebroot(const QString &webroot)
 {
-    this->settings->setValue(keyName(Key::Webroot), webroot);
-    emit configUpdated(Key::Webroot);
+    this->set<Key::Webroot>(webroot);
+}
+
+void ConfigManager::setSysTrayIconEnabled(bool enabled)
+{
+    this->set<Key::SysTrayIconEnabled>(enabled);
+}
+
+void ConfigManager::setDownloadsLastDirectory(const QString &directory)
+{
+    this->set<Key::DownloadsLastDirectory>(directory);
 }
 
 const QString ConfigManager::webroot() const
 {
-    return this->settings->value(keyName(Key::Webroot), value(Key::Webroot)).toString();
+    return this->_snapshot->webroot;
 }
 
-void ConfigManager::setSysTrayIconEnabled(bool enabled)
+bool ConfigManager::optimizeIndex() const
 {
-    this->settings->setValue(keyName(Key::SysTrayIconEnabled), enabled);
-    emit configUpdated(Key::SysTrayIconEnabled);
+    return this->_snapshot->optimizeIndex;
+}
+
+bool ConfigManager::serviceWorker() const
+{
+    return this->_snapshot->serviceWorker;
 }
 
 bool ConfigManager::sysTrayIconEnabled() const
 {
-    return this->settings->value(keyName(Key::SysTrayIconEnabled), value(Key::SysTrayIconEnabled)).toBool();
+    return this->_snapshot->sysTrayIconEnabled;
+}
+
+bool ConfigManager::startupSnapshot() const
+{
+    return this->_snapshot->startupSnapshot;
+}
+
+const QString ConfigManager::enginePreset() const
+{
+    return this->_snapshot->enginePreset;
+}
+
+const QString ConfigManager::engineProcessModel() const
+{
+    return this->_snapshot->engineProcessModel;
+}
+
+int ConfigManager::engineRendererProcessLimit() const
+{
+    return this->_snapshot->engineRendererProcessLimit;
+}
+
+int ConfigManager::engineJsHeapLimit() const
+{
+    return this->_snapshot->engineJsHeapLimit;
+}
+
+int ConfigManager::engineRasterThreads() const
+{
+    return this->_snapshot->engineRasterThreads;
+}
+
+bool ConfigManager::engineGpuCompositing() const
+{
+    return this->_snapshot->engineGpuCompositing;
+}
+
+int ConfigManager::engineHttpCacheSize() const
+{
+    return this->_snapshot->engineHttpCacheSize;
+}
+
+int ConfigManager::downloadsMaxConcurrent() const
+{
+    return this->_snapshot->downloadsMaxConcurrent;
+}
+
+bool ConfigManager::downloadsAskForLocation() const
+{
+    return this->_snapshot->downloadsAskForLocation;
+}
+
+const QString ConfigManager::downloadsLastDirectory() const
+{
+    return this->_snapshot->downloadsLastDirectory;
+}
+
+bool ConfigManager::mediaCacheEnabled() const
+{
+    return this->_snapshot->mediaCacheEnabled;
+}
+
+int ConfigManager::mediaCacheSize() const
+{
+    return this->_snapshot->mediaCacheSize;
+}
+
+bool ConfigManager::networkMonitorEnabled() const
+{
+    return this->_snapshot->networkMonitorEnabled;
+}
+
+int ConfigManager::networkMonitorInterval() const
+{
+    return this->_snapshot->networkMonitorInterval;
+}
+
+const QString ConfigManager::cacheType() const
+{
+    return this->_snapshot->cacheType;
+}
+
+const QString ConfigManager::cacheLocation() const
+{
+    return this->_snapshot->cacheLocation;
+}
+
+bool ConfigManager::cacheWriteBack() const
+{
+    return this->_snapshot->cacheWriteBack;
+}
+
+int ConfigManager::cacheWriteBackSize() const
+{
+    return this->_snapshot->cacheWriteBackSize;
+}
+
+bool ConfigManager::diagnosticsWatchdogEnabled() const
+{
+    return this->_snapshot->diagnosticsWatchdogEnabled;
+}
+
+int ConfigManager::diagnosticsStallThreshold() const
+{
+    return this->_snapshot->diagnosticsStallThreshold;
+}
+
+bool ConfigManager::diagnosticsStackCapture() const
+{
+    return this->_snapshot->diagnosticsStackCapture;
+}
+
+bool ConfigManager::diagnosticsConsoleLogEnabled() const
+{
+    return this->_snapshot->diagnosticsConsoleLogEnabled;
+}
+
+int ConfigManager::diagnosticsConsoleLogSize() const
+{
+    return this->_snapshot->diagnosticsConsoleLogSize;
+}
+
+bool ConfigManager::cryptoNativeEnabled() const
+{
+    return this->_snapshot->cryptoNativeEnabled;
+}
+
+bool ConfigManager::searchEventIndexEnabled() const
+{
+    return this->_snapshot->searchEventIndexEnabled;
+}
+
+const QString ConfigManager::logSink() const
+{
+    return this->_snapshot->logSink;
+}
+
+int ConfigManager::logFileSize() const
+{
+    return this->_snapshot->logFileSize;
+}
+
+int ConfigManager::logFiles() const
+{
+    return this->_snapshot->logFiles;
 }
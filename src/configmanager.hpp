@@ -2,9 +2,12 @@
 
 #include <QObject>
 #include <QSettings>
+#include <QString>
 
 #include <memory>
 
+class QFileSystemWatcher;
+
 class ConfigManager : public QObject
 {
     Q_OBJECT
@@ -16,20 +19,194 @@ public:
     enum class Key
     {
         Webroot,
+        OptimizeIndex,
+        ServiceWorker,
         SysTrayIconEnabled,
+        StartupSnapshot,
+
+        EnginePreset,
+        EngineProcessModel,
+        EngineRendererProcessLimit,
+        EngineJsHeapLimit,
+        EngineRasterThreads,
+        EngineGpuCompositing,
+        EngineHttpCacheSize,
+
+        DownloadsMaxConcurrent,
+        DownloadsAskForLocation,
+        DownloadsLastDirectory,
+
+        MediaCacheEnabled,
+        MediaCacheSize,
+
+        NetworkMonitorEnabled,
+        NetworkMonitorInterval,
+
+        CacheType,
+        CacheLocation,
+        CacheWriteBack,
+        CacheWriteBackSize,
+
+        DiagnosticsWatchdogEnabled,
+        DiagnosticsStallThreshold,
+        DiagnosticsStackCapture,
+        DiagnosticsConsoleLogEnabled,
+        DiagnosticsConsoleLogSize,
+
+        CryptoNativeEnabled,
+
+        SearchEventIndexEnabled,
+
+        LogSink,
+        LogFileSize,
+        LogFiles,
+    };
+
+    /**
+     * Typed values of all keys. A snapshot is never modified, changes
+     * replace the current snapshot, so a snapshot can be handed to other
+     * threads and read there without locking.
+     */
+    struct Snapshot
+    {
+        QString webroot;
+        bool optimizeIndex;
+        bool serviceWorker;
+        bool sysTrayIconEnabled;
+        bool startupSnapshot;
+
+        QString enginePreset;
+        QString engineProcessModel;
+        int engineRendererProcessLimit;
+        int engineJsHeapLimit;
+        int engineRasterThreads;
+        bool engineGpuCompositing;
+        int engineHttpCacheSize;
+
+        int downloadsMaxConcurrent;
+        bool downloadsAskForLocation;
+        QString downloadsLastDirectory;
+
+        bool mediaCacheEnabled;
+        int mediaCacheSize;
+
+        bool networkMonitorEnabled;
+        int networkMonitorInterval;
+
+        QString cacheType;
+        QString cacheLocation;
+        bool cacheWriteBack;
+        int cacheWriteBackSize;
+
+        bool diagnosticsWatchdogEnabled;
+        int diagnosticsStallThreshold;
+        bool diagnosticsStackCapture;
+        bool diagnosticsConsoleLogEnabled;
+        int diagnosticsConsoleLogSize;
+
+        bool cryptoNativeEnabled;
+
+        bool searchEventIndexEnabled;
+
+        QString logSink;
+        int logFileSize;
+        int logFiles;
     };
 
+    /**
+     * Reloads the preferences when the file is edited and emits configUpdated
+     * for every changed key. The watcher needs the event dispatcher of the
+     * thread, so this must be called after the QApplication is created.
+     */
+    void startWatching();
+
+    /**
+     * Current values. The getters below read from the current snapshot.
+     */
+    std::shared_ptr<const Snapshot> snapshot() const;
+
     void setWebroot(const QString &webroot);
     const QString webroot() const;
 
+    // serve index.html with inlined config and preload hints, see ElementUrlScheme
+    bool optimizeIndex() const;
+
+    // allow service workers on element://, only read once on startup when the scheme is registered,
+    // off until tools/service-worker-benchmark has shown that the worker controls the page
+    bool serviceWorker() const;
+
     void setSysTrayIconEnabled(bool enabled);
     bool sysTrayIconEnabled() const;
 
+    // paint the last frame of the web app on startup until it is ready, see BrowserWindow
+    bool startupSnapshot() const;
+
+    // engine options are only read once on startup before QtWebEngine is initialized,
+    // see EngineOptions for the meaning and valid ranges of the values
+    const QString enginePreset() const;
+    const QString engineProcessModel() const;
+    int engineRendererProcessLimit() const;
+    int engineJsHeapLimit() const;
+    int engineRasterThreads() const;
+    bool engineGpuCompositing() const;
+    int engineHttpCacheSize() const;
+
+    int downloadsMaxConcurrent() const;
+    bool downloadsAskForLocation() const;
+
+    void setDownloadsLastDirectory(const QString &directory);
+    const QString downloadsLastDirectory() const;
+
+    // media cache size in MiB
+    bool mediaCacheEnabled() const;
+    int mediaCacheSize() const;
+
+    // interval of the network summary log in seconds
+    bool networkMonitorEnabled() const;
+    int networkMonitorInterval() const;
+
+    // see HttpCache for the cache types, the size of the cache is engine/httpCacheSize
+    const QString cacheType() const;
+    const QString cacheLocation() const;
+    bool cacheWriteBack() const;
+    int cacheWriteBackSize() const;
+
+    // watchdog which logs stalls of the user interface thread
+    bool diagnosticsWatchdogEnabled() const;
+
+    // stall threshold of the watchdog in ms
+    int diagnosticsStallThreshold() const;
+
+    // best-effort stack of the user interface thread on stalls, see StallWatchdog
+    bool diagnosticsStackCapture() const;
+
+    // records the console messages of the web app, the size of the ring file is in MiB
+    bool diagnosticsConsoleLogEnabled() const;
+    int diagnosticsConsoleLogSize() const;
+
+    // experimental, only available when built with ENABLE_NATIVE_CRYPTO,
+    // element-web must be patched to call window.qelementCrypto
+    bool cryptoNativeEnabled() const;
+
+    // native index for the search in encrypted rooms
+    bool searchEventIndexEnabled() const;
+
+    // console, journal or file, the log files are rotated at fileSize MiB
+    const QString logSink() const;
+    int logFileSize() const;
+    int logFiles() const;
+
 signals:
     void configUpdated(const Key &key);
 
 private:
-    std::unique_ptr<QSettings> settings;
+    template<Key K, typename T>
+    void set(const T &value);
 
-    void initialize_key(const Key &key);
+    const Snapshot read() const;
+    void reload();
+
+    std::unique_ptr<QSettings> settings;
+    std::unique_ptr<QFileSystemWatcher> watcher;
+    std::shared_ptr<const Snapshot> _snapshot;
 };
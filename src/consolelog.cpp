@@ -0,0 +1,281 @@
+#include "consolelog.hpp"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDebug>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    constexpr const char magic[8] = {'Q', 'E', 'C', 'O', 'N', 'S', 'O', 'L'};
+    constexpr const quint32 version = 1;
+
+    // the header takes the first slot, the records the following slots
+    constexpr const quint32 slotSize = 512;
+
+    struct FileHeader
+    {
+        char magic[8];
+        quint32 version;
+        quint32 slotSize;
+        quint32 slotCount;
+        quint32 reserved;
+        quint64 nextSequence;
+    };
+
+    // the sequence is written last, records with sequence 0 are incomplete
+    struct RecordHeader
+    {
+        quint64 sequence;
+        qint64 timestamp;
+        qint64 lastTimestamp;
+        quint32 line;
+        quint32 repeat;
+        quint32 suppressed;
+        quint8 level;
+        quint8 reserved;
+        quint16 sourceLength;
+        quint16 messageLength;
+        quint16 reserved2;
+    };
+
+    constexpr const std::size_t textSize = slotSize - sizeof(RecordHeader);
+
+    // long urls keep their end, the file name is the interesting part
+    constexpr const std::size_t maxSourceLength = 128;
+
+    // per source at most burst messages at once and rateLimit per second afterwards
+    constexpr const double rateLimit = 10;
+    constexpr const double burst = 50;
+
+    const char *levelName(int level)
+    {
+        switch (level)
+        {
+            case 0:  return "info";
+            case 1:  return "warning";
+            case 2:  return "error";
+            default: return "unknown";
+        }
+    }
+
+    // copies at most size bytes without cutting a multi byte sequence
+    std::size_t copyUtf8(char *out, const QByteArray &text, std::size_t size)
+    {
+        auto length = std::min(std::size_t(text.size()), size);
+        while (length < std::size_t(text.size()) && length > 0 && (uchar(text.at(qsizetype(length))) & 0xC0) == 0x80)
+        {
+            --length;
+        }
+        std::memcpy(out, text.constData(), length);
+        return length;
+    }
+}
+
+ConsoleLog::ConsoleLog(const QString &file, qint64 size)
+    : file(file)
+{
+    this->size = size;
+}
+
+ConsoleLog::~ConsoleLog()
+{
+    if (this->memory)
+    {
+        this->file.unmap(this->memory);
+    }
+}
+
+bool ConsoleLog::open()
+{
+    this->slotCount = quint32(std::max<qint64>(16, this->size / slotSize - 1));
+    const auto fileSize = qint64(slotSize) * (this->slotCount + 1);
+
+    QDir().mkpath(QFileInfo(this->file).absolutePath());
+    if (!this->file.open(QIODevice::ReadWrite) ||
+        (this->file.size() != fileSize && !this->file.resize(fileSize)))
+    {
+        qWarning() << "unable to open the console log:" << this->file.fileName() << this->file.errorString();
+        return false;
+    }
+
+    this->memory = this->file.map(0, fileSize);
+    if (!this->memory)
+    {
+        qWarning() << "unable to map the console log:" << this->file.fileName() << this->file.errorString();
+        return false;
+    }
+
+    // start over when the file is new or has another layout
+    auto header = reinterpret_cast<FileHeader*>(this->memory);
+    if (std::memcmp(header->magic, magic, sizeof(magic)) != 0 || header->version != version ||
+        header->slotSize != slotSize || header->slotCount != this->slotCount || header->nextSequence == 0)
+    {
+        std::memset(this->memory, 0, std::size_t(fileSize));
+        std::memcpy(header->magic, magic, sizeof(magic));
+        header->version = version;
+        header->slotSize = slotSize;
+        header->slotCount = this->slotCount;
+        header->nextSequence = 1;
+    }
+
+    return true;
+}
+
+void ConsoleLog::record(int level, const QString &message, int line, const QString &source)
+{
+    if (!this->memory)
+    {
+        return;
+    }
+
+    const auto now = QDateTime::currentMSecsSinceEpoch();
+    const auto hash = qHash(message);
+    auto header = reinterpret_cast<FileHeader*>(this->memory);
+
+    auto it = this->sources.find(source);
+    if (it == this->sources.end())
+    {
+        it = this->sources.insert(source, Source{burst, now});
+    }
+    auto &state = it.value();
+
+    // a repetition only counts in the last record of the source, as long as it wasn't overwritten
+    if (state.sequence && state.level == level && state.line == line && state.hash == hash &&
+        header->nextSequence - state.sequence <= this->slotCount)
+    {
+        auto record = reinterpret_cast<RecordHeader*>(this->slot(state.sequence));
+        if (record->sequence == state.sequence)
+        {
+            ++record->repeat;
+            record->lastTimestamp = now;
+            return;
+        }
+    }
+
+    if (!this->allow(state, now))
+    {
+        ++state.suppressed;
+        return;
+    }
+
+    const auto sequence = header->nextSequence++;
+    auto data = this->slot(sequence);
+    auto record = reinterpret_cast<RecordHeader*>(data);
+    record->sequence = 0;
+    std::atomic_signal_fence(std::memory_order_release);
+
+    record->timestamp = now;
+    record->lastTimestamp = now;
+    record->line = quint32(std::max(0, line));
+    record->repeat = 0;
+    record->suppressed = state.suppressed;
+    record->level = quint8(level);
+
+    auto sourceUtf8 = source.toUtf8();
+    if (std::size_t(sourceUtf8.size()) > maxSourceLength)
+    {
+        sourceUtf8 = sourceUtf8.right(qsizetype(maxSourceLength));
+    }
+    auto text = reinterpret_cast<char*>(data + sizeof(RecordHeader));
+    record->sourceLength = quint16(copyUtf8(text, sourceUtf8, maxSourceLength));
+    record->messageLength = quint16(copyUtf8(text + record->sourceLength, message.toUtf8(), textSize - record->sourceLength));
+
+    // the record is complete once it has its sequence
+    std::atomic_signal_fence(std::memory_order_release);
+    record->sequence = sequence;
+
+    state.sequence = sequence;
+    state.level = level;
+    state.line = line;
+    state.hash = hash;
+    state.suppressed = 0;
+}
+
+bool ConsoleLog::allow(Source &source, qint64 now)
+{
+    source.tokens = std::min(burst, source.tokens + double(now - source.refilled) / 1000 * rateLimit);
+    source.refilled = now;
+    if (source.tokens < 1)
+    {
+        return false;
+    }
+
+    source.tokens -= 1;
+    return true;
+}
+
+uchar *ConsoleLog::slot(quint64 sequence) const
+{
+    return this->memory + std::size_t(slotSize) * (1 + sequence % this->slotCount);
+}
+
+bool ConsoleLog::dump(const QString &file, std::FILE *out)
+{
+    QFile input(file);
+    if (!input.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    const auto data = input.readAll();
+    if (std::size_t(data.size()) < slotSize)
+    {
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, data.constData(), sizeof(header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version ||
+        header.slotSize != slotSize || header.slotCount == 0 || qint64(slotSize) * (header.slotCount + 1) > data.size())
+    {
+        return false;
+    }
+
+    // complete records in the slot of their sequence, ordered from the oldest
+    std::vector<std::pair<RecordHeader, const char*>> records;
+    for (quint32 i = 0; i < header.slotCount; ++i)
+    {
+        const auto slot = data.constData() + std::size_t(slotSize) * (1 + i);
+        RecordHeader record;
+        std::memcpy(&record, slot, sizeof(record));
+        if (record.sequence == 0 || record.sequence % header.slotCount != i ||
+            std::size_t(record.sourceLength) + record.messageLength > textSize)
+        {
+            continue;
+        }
+        records.emplace_back(record, slot + sizeof(RecordHeader));
+    }
+    std::sort(records.begin(), records.end(), [](auto &a, auto &b) {
+        return a.first.sequence < b.first.sequence;
+    });
+
+    const auto time = [](qint64 timestamp) {
+        return QDateTime::fromMSecsSinceEpoch(timestamp).toString("yyyy-MM-dd HH:mm:ss.zzz").toUtf8();
+    };
+
+    for (auto&& [record, text] : records)
+    {
+        if (record.suppressed)
+        {
+            std::fprintf(out, "%s %-8s %.*s: %u messages suppressed\n", time(record.timestamp).constData(), "",
+                int(record.sourceLength), text, record.suppressed);
+        }
+
+        std::fprintf(out, "%s %-8s %.*s:%u: %.*s", time(record.timestamp).constData(), levelName(record.level),
+            int(record.sourceLength), text, record.line,
+            int(record.messageLength), text + record.sourceLength);
+        if (record.repeat)
+        {
+            std::fprintf(out, " (repeated %u times until %s)", record.repeat, time(record.lastTimestamp).constData());
+        }
+        std::fprintf(out, "\n");
+    }
+
+    return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QFile>
+#include <QHash>
+#include <QString>
+
+#include <cstdint>
+#include <cstdio>
+
+/**
+ * Records the JavaScript console messages of the web app into a fixed-size
+ * memory-mapped ring file, so they survive a crash of the process.
+ *
+ * The file is a header followed by slots of equal size, a message goes into
+ * the slot of its sequence number and overwrites the oldest one. Repeated
+ * messages of a source only increment the repeat count of their record and
+ * every source is rate limited, suppressed messages are counted in the next
+ * record of the source. Recording is a copy into the mapping without any
+ * system call.
+ */
+class ConsoleLog
+{
+public:
+    ConsoleLog(const QString &file, qint64 size);
+    ~ConsoleLog();
+
+    // maps the file, the records of the previous run are kept when the size didn't change
+    bool open();
+
+    // level is a QWebEnginePage::JavaScriptConsoleMessageLevel
+    void record(int level, const QString &message, int line, const QString &source);
+
+    /**
+     * Writes the records of the file as text lines from the oldest to the
+     * newest. Returns false when the file isn't a console log.
+     */
+    static bool dump(const QString &file, std::FILE *out);
+
+private:
+    struct Source
+    {
+        // token bucket, refilled at rateLimit per second
+        double tokens = 0;
+        qint64 refilled = 0;
+        quint32 suppressed = 0;
+
+        // last record of the source and what it contained for the deduplication
+        quint64 sequence = 0;
+        int level = -1;
+        int line = -1;
+        size_t hash = 0;
+    };
+
+    bool allow(Source &source, qint64 now);
+    uchar *slot(quint64 sequence) const;
+
+    QFile file;
+    qint64 size;
+    uchar *memory = nullptr;
+    quint32 slotCount = 0;
+    QHash<QString, Source> sources;
+};
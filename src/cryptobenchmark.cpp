@@ -0,0 +1,363 @@
+#include "cryptobenchmark.hpp"
+
+#ifdef NATIVE_CRYPTO_ENABLED
+
+#include "nativecrypto.hpp"
+#include "elementurlscheme.hpp"
+#include "userscripts.hpp"
+
+#include <QWebEngineProfile>
+#include <QWebEnginePage>
+#include <QWebChannel>
+#include <QWebEngineScript>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QRandomGenerator>
+#include <QFileInfo>
+#include <QThread>
+#include <QTimer>
+#include <QDir>
+#include <QDebug>
+
+#include <olm/olm.h>
+
+#include <vector>
+
+// number of megolm sessions the events are spread over
+constexpr const int sessionCount = 16;
+
+// interval to query the results from the page
+constexpr const int pollInterval = 100;
+
+// give up when the page didn't finish in time
+constexpr const qint64 pageTimeout = 5 * 60 * 1000;
+
+// decrypts the backlog with matrix-sdk-crypto-wasm, which element-web uses, when the package
+// is served and through window.qelementCrypto, %1 is replaced with {keys: {sessionId: key},
+// exported: {sessionId: exported key}, rooms: {sessionId: roomId}, senderKey, signingKey,
+// events: [{eventId, sessionId, ciphertext}]}
+static const char *pageScript = R"(
+(async function() {
+    const data = %1;
+    const results = {};
+    const measure = async (name, setup, decrypt) => {
+        try {
+            await setup();
+            const start = performance.now();
+            const decrypted = await decrypt();
+            results[name] = {ms: performance.now() - start, decrypted: decrypted};
+        } catch (e) {
+            results[name] = {error: String(e)};
+        }
+    };
+
+    let sdk = null;
+    try {
+        sdk = await import("element://localhost/index.mjs");
+    } catch (e) {
+        results.wasm = {error: "matrix-sdk-crypto-wasm not loaded: " + e};
+    }
+
+    if (sdk) {
+        let machine = null;
+        await measure("wasm", async () => {
+            await sdk.initAsync();
+            machine = await sdk.OlmMachine.initialize(new sdk.UserId("@benchmark:localhost"), new sdk.DeviceId("BENCHMARK"));
+            const keys = Object.entries(data.exported).map(([id, key]) => ({
+                algorithm: "m.megolm.v1.aes-sha2",
+                room_id: data.rooms[id],
+                sender_key: data.senderKey,
+                session_id: id,
+                session_key: key,
+                sender_claimed_keys: {ed25519: data.signingKey},
+                forwarding_curve25519_key_chain: [],
+            }));
+            await machine.importExportedRoomKeys(JSON.stringify(keys), () => {});
+        }, async () => {
+            const settings = sdk.DecryptionSettings ? new sdk.DecryptionSettings(sdk.TrustRequirement.Untrusted) : undefined;
+            let decrypted = 0;
+            for (const [i, e] of data.events.entries()) {
+                const event = {
+                    type: "m.room.encrypted",
+                    event_id: e.eventId,
+                    sender: "@benchmark:localhost",
+                    origin_server_ts: i,
+                    room_id: data.rooms[e.sessionId],
+                    content: {
+                        algorithm: "m.megolm.v1.aes-sha2",
+                        ciphertext: e.ciphertext,
+                        sender_key: data.senderKey,
+                        session_id: e.sessionId,
+                        device_id: "BENCHMARK",
+                    },
+                };
+                try {
+                    await machine.decryptRoomEvent(JSON.stringify(event), new sdk.RoomId(event.room_id), settings);
+                    ++decrypted;
+                } catch (error) {
+                }
+            }
+            return decrypted;
+        });
+    }
+
+    if (window.qelementCrypto && await window.qelementCrypto.ready) {
+        await measure("bridge", async () => {
+            for (const [id, key] of Object.entries(data.keys)) {
+                await window.qelementCrypto.importSession(id, key, false);
+            }
+        }, async () => (await window.qelementCrypto.decryptBatch(data.events)).filter(r => r.plaintext).length);
+    } else {
+        results.bridge = {error: "web channel not available"};
+    }
+
+    window.__qelement_crypto_benchmark = results;
+})();
+)";
+
+static const char *queryScript = "JSON.stringify(window.__qelement_crypto_benchmark || null)";
+
+static int countDecrypted(const QVariantList &results)
+{
+    int decrypted = 0;
+    for (auto&& result : results)
+    {
+        if (result.toMap().contains("plaintext"))
+        {
+            ++decrypted;
+        }
+    }
+    return decrypted;
+}
+
+CryptoBenchmark::CryptoBenchmark(int events, const QString &wasmPackage, QObject *parent)
+    : QObject(parent)
+{
+    this->events = events;
+    this->wasmPackage = wasmPackage;
+
+    this->pollTimer = std::make_unique<QTimer>();
+    this->pollTimer->setInterval(pollInterval);
+    connect(this->pollTimer.get(), &QTimer::timeout, this, &CryptoBenchmark::pollPage);
+}
+
+CryptoBenchmark::~CryptoBenchmark()
+{
+    this->pollTimer->stop();
+    if (this->page)
+    {
+        this->page->setWebChannel(nullptr);
+    }
+}
+
+void CryptoBenchmark::start()
+{
+    this->generate();
+    this->runNative();
+    this->runPage();
+}
+
+const QJsonObject CryptoBenchmark::report() const
+{
+    return {
+        {"events", this->events},
+        {"sessions", this->sessionKeys.size()},
+        {"threads", QThread::idealThreadCount()},
+        {"native", QJsonObject{
+            {"serial", this->nativeSerial},
+            {"parallel", this->nativeParallel},
+            {"decrypted", this->nativeDecrypted},
+        }},
+        {"bridge", this->pageResults.value("bridge")},
+        {"wasm", this->pageResults.value("wasm")},
+    };
+}
+
+void CryptoBenchmark::generate()
+{
+    struct Outbound
+    {
+        std::vector<uint8_t> memory;
+        OlmOutboundGroupSession *session;
+        QString id;
+    };
+
+    std::vector<Outbound> outbound(sessionCount);
+    for (auto&& session : outbound)
+    {
+        session.memory.resize(olm_outbound_group_session_size());
+        session.session = olm_outbound_group_session(session.memory.data());
+
+        std::vector<uint8_t> random(olm_init_outbound_group_session_random_length(session.session));
+        QRandomGenerator::system()->generate(random.begin(), random.end());
+        olm_init_outbound_group_session(session.session, random.data(), random.size());
+
+        QByteArray id(qsizetype(olm_outbound_group_session_id_length(session.session)), Qt::Uninitialized);
+        olm_outbound_group_session_id(session.session, reinterpret_cast<uint8_t*>(id.data()), std::size_t(id.size()));
+        session.id = QString::fromUtf8(id);
+
+        QByteArray key(qsizetype(olm_outbound_group_session_key_length(session.session)), Qt::Uninitialized);
+        olm_outbound_group_session_key(session.session, reinterpret_cast<uint8_t*>(key.data()), std::size_t(key.size()));
+        this->sessionKeys.insert(session.id, QString::fromUtf8(key));
+
+        // matrix-sdk-crypto-wasm only imports keys in the export format of inbound sessions
+        std::vector<uint8_t> inboundMemory(olm_inbound_group_session_size());
+        auto inbound = olm_inbound_group_session(inboundMemory.data());
+        auto keyCopy = key;
+        olm_init_inbound_group_session(inbound, reinterpret_cast<const uint8_t*>(keyCopy.constData()), std::size_t(keyCopy.size()));
+        QByteArray exported(qsizetype(olm_export_inbound_group_session_length(inbound)), Qt::Uninitialized);
+        olm_export_inbound_group_session(inbound, reinterpret_cast<uint8_t*>(exported.data()), std::size_t(exported.size()), 0);
+        olm_clear_inbound_group_session(inbound);
+        this->exportedKeys.insert(session.id, QString::fromUtf8(exported));
+        this->sessionRooms.insert(session.id, QString("!benchmark%1:localhost").arg(this->sessionRooms.size()));
+    }
+
+    // the sender of all sessions, any valid curve25519 and ed25519 keys do
+    const auto randomKey = [] {
+        QByteArray key(32, Qt::Uninitialized);
+        QRandomGenerator::system()->generate(key.begin(), key.end());
+        return QString::fromLatin1(key.toBase64(QByteArray::OmitTrailingEquals));
+    };
+    this->senderKey = randomKey();
+    this->signingKey = randomKey();
+
+    // round robin over the sessions like a backlog of several rooms
+    this->encrypted.clear();
+    this->encrypted.reserve(this->events);
+    for (auto i = 0; i < this->events; ++i)
+    {
+        auto &session = outbound[std::size_t(i % sessionCount)];
+
+        const auto plaintext = QJsonDocument(QJsonObject{
+            {"type", "m.room.message"},
+            {"room_id", this->sessionRooms.value(session.id)},
+            {"content", QJsonObject{
+                {"msgtype", "m.text"},
+                {"body", QString("benchmark message %1 with some text to make it look like a regular chat message").arg(i)},
+            }},
+        }).toJson(QJsonDocument::Compact);
+
+        QByteArray message(qsizetype(olm_group_encrypt_message_length(session.session, std::size_t(plaintext.size()))), Qt::Uninitialized);
+        olm_group_encrypt(session.session,
+            reinterpret_cast<const uint8_t*>(plaintext.constData()), std::size_t(plaintext.size()),
+            reinterpret_cast<uint8_t*>(message.data()), std::size_t(message.size()));
+
+        this->encrypted.append(QVariantMap{
+            {"eventId", QString("$benchmark%1").arg(i)},
+            {"sessionId", session.id},
+            {"ciphertext", QString::fromUtf8(message)},
+        });
+    }
+
+    for (auto&& session : outbound)
+    {
+        olm_clear_outbound_group_session(session.session);
+    }
+}
+
+void CryptoBenchmark::runNative()
+{
+    const auto measure = [this](int threads) {
+        NativeCrypto crypto(threads);
+        for (auto it = this->sessionKeys.cbegin(); it != this->sessionKeys.cend(); ++it)
+        {
+            crypto.importSession(it.key(), it.value(), false);
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        const auto results = crypto.decrypt(this->encrypted);
+        const auto ms = timer.nsecsElapsed() / 1e6;
+
+        this->nativeDecrypted = countDecrypted(results);
+        return ms;
+    };
+
+    this->nativeSerial = measure(1);
+    this->nativeParallel = measure(0);
+
+    qDebug() << "crypto benchmark: native decrypted" << this->nativeDecrypted << "of" << this->events << "events";
+}
+
+void CryptoBenchmark::runPage()
+{
+    // the package loads its wasm relative to index.mjs, serve its directory on element://localhost/
+    const auto root = this->wasmPackage.isEmpty() ? QDir::tempPath() : QFileInfo(this->wasmPackage).absoluteFilePath();
+    this->handler = std::make_unique<ElementUrlScheme>(root);
+
+    // off-the-record profiles keep everything in memory and start empty
+    this->profile = std::make_unique<QWebEngineProfile>();
+    this->profile->installUrlSchemeHandler(ElementUrlScheme::schemeName(), this->handler.get());
+    UserScripts::installNativeCrypto(this->profile.get());
+
+    this->bridgeCrypto = std::make_unique<NativeCrypto>();
+    this->webChannel = std::make_unique<QWebChannel>();
+    this->webChannel->registerObject(NativeCrypto::channelName(), this->bridgeCrypto.get());
+
+    this->page = std::make_unique<QWebEnginePage>(this->profile.get());
+    this->page->setWebChannel(this->webChannel.get(), QWebEngineScript::MainWorld);
+    connect(this->page.get(), &QWebEnginePage::loadFinished, this, [this](bool ok) {
+        if (!ok)
+        {
+            qWarning() << "crypto benchmark: failed to load the benchmark page";
+            emit finished(false);
+            return;
+        }
+
+        const auto object = [](const QHash<QString, QString> &hash) {
+            QJsonObject object;
+            for (auto it = hash.cbegin(); it != hash.cend(); ++it)
+            {
+                object.insert(it.key(), it.value());
+            }
+            return object;
+        };
+        const auto data = QJsonDocument(QJsonObject{
+            {"keys", object(this->sessionKeys)},
+            {"exported", object(this->exportedKeys)},
+            {"rooms", object(this->sessionRooms)},
+            {"senderKey", this->senderKey},
+            {"signingKey", this->signingKey},
+            {"events", QJsonArray::fromVariantList(this->encrypted)},
+        }).toJson(QJsonDocument::Compact);
+
+        this->page->runJavaScript(QString(pageScript).arg(QString::fromUtf8(data)));
+        this->timer.start();
+        this->pollTimer->start();
+    });
+
+    this->page->setHtml("<!DOCTYPE html><html><head></head><body></body></html>", QUrl("element://localhost/"));
+}
+
+void CryptoBenchmark::pollPage()
+{
+    if (this->timer.elapsed() > pageTimeout)
+    {
+        qWarning() << "crypto benchmark: page didn't finish within" << pageTimeout << "ms";
+        this->pollTimer->stop();
+        emit finished(false);
+        return;
+    }
+
+    // skip this tick while the previous query is still pending
+    this->pollTimer->stop();
+
+    this->page->runJavaScript(queryScript, [this](const QVariant &result) {
+        const auto results = QJsonDocument::fromJson(result.toString().toUtf8());
+        if (!results.isObject())
+        {
+            this->pollTimer->start();
+            return;
+        }
+
+        this->pageResults = results.object();
+
+        // the wasm path is optional, the native paths must decrypt everything
+        const auto bridge = this->pageResults.value("bridge").toObject();
+        const auto success = this->nativeDecrypted == this->events &&
+            bridge.value("decrypted").toInt(-1) == this->events;
+        emit finished(success);
+    });
+}
+
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+
+#ifdef NATIVE_CRYPTO_ENABLED
+
+#include <QObject>
+#include <QHash>
+#include <QVariant>
+#include <QJsonObject>
+#include <QElapsedTimer>
+
+#include <memory>
+
+class QWebEngineProfile;
+class QWebEnginePage;
+class QWebChannel;
+class QTimer;
+class ElementUrlScheme;
+class NativeCrypto;
+
+/**
+ * Decrypts a synthetic backlog of megolm events through all paths:
+ *
+ *  - native: NativeCrypto called directly, with one thread and the thread pool
+ *  - bridge: from a page through window.qelementCrypto and QWebChannel
+ *  - wasm:   from a page with matrix-sdk-crypto-wasm, the decryption of
+ *            current element-web, only when the package directory is given
+ *
+ * The events are spread over several megolm sessions like a real backlog.
+ * All timings are in milliseconds and exclude the session setup.
+ */
+class CryptoBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    // wasmPackage is the directory of @matrix-org/matrix-sdk-crypto-wasm with its index.mjs
+    CryptoBenchmark(int events, const QString &wasmPackage, QObject *parent = nullptr);
+    ~CryptoBenchmark();
+
+    void start();
+
+    const QJsonObject report() const;
+
+signals:
+    void finished(bool success);
+
+private:
+    void generate();
+    void runNative();
+    void runPage();
+    void pollPage();
+
+    int events;
+    QString wasmPackage;
+
+    QHash<QString, QString> sessionKeys;
+    QHash<QString, QString> exportedKeys;
+    QHash<QString, QString> sessionRooms;
+    QString senderKey;
+    QString signingKey;
+    QVariantList encrypted;
+
+    double nativeSerial = -1;
+    double nativeParallel = -1;
+    int nativeDecrypted = 0;
+    QJsonObject pageResults;
+
+    std::unique_ptr<NativeCrypto> bridgeCrypto;
+    std::unique_ptr<QWebChannel> webChannel;
+    std::unique_ptr<ElementUrlScheme> handler;
+    std::unique_ptr<QWebEngineProfile> profile;
+    std::unique_ptr<QWebEnginePage> page;
+    std::unique_ptr<QTimer> pollTimer;
+    QElapsedTimer timer;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#include "diagnosticsdialog.hpp"
+#include "stallwatchdog.hpp"
+
+#include <QPlainTextEdit>
+#include <QVBoxLayout>
+#include <QDialogButtonBox>
+#include <QPushButton>
+#include <QFontDatabase>
+#include <QFile>
+
+#include <algorithm>
+
+// only the end of the log is shown
+constexpr const qint64 maxLogTail = 64 * 1024;
+
+DiagnosticsDialog::DiagnosticsDialog(const StallWatchdog *watchdog, QWidget *parent)
+    : QDialog(parent)
+{
+    this->watchdog = watchdog;
+
+    this->setWindowTitle(tr("Diagnostics"));
+    this->resize(800, 600);
+
+    this->text = std::make_unique<QPlainTextEdit>();
+    this->text->setReadOnly(true);
+    this->text->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+
+    auto buttons = new QDialogButtonBox(QDialogButtonBox::Close, this);
+    auto refreshButton = buttons->addButton(tr("Refresh"), QDialogButtonBox::ActionRole);
+    connect(refreshButton, &QPushButton::clicked, this, &DiagnosticsDialog::refresh);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    this->layout = std::make_unique<QVBoxLayout>();
+    this->layout->addWidget(this->text.get());
+    this->layout->addWidget(buttons);
+    this->setLayout(this->layout.get());
+
+    this->refresh();
+}
+
+DiagnosticsDialog::~DiagnosticsDialog()
+{
+}
+
+void DiagnosticsDialog::refresh()
+{
+    auto content = this->watchdog->histogram();
+
+    QFile log(this->watchdog->logFile());
+    if (log.open(QIODevice::ReadOnly))
+    {
+        log.seek(std::max(qint64(0), log.size() - maxLogTail));
+        content.append(QString("\n%1:\n").arg(this->watchdog->logFile()));
+        content.append(QString::fromUtf8(log.readAll()));
+    }
+
+    this->text->setPlainText(content);
+    this->text->moveCursor(QTextCursor::End);
+}
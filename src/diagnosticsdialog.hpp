@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QDialog>
+
+#include <memory>
+
+class QPlainTextEdit;
+class QVBoxLayout;
+class StallWatchdog;
+
+/**
+ * Shows the event loop lag histogram and the diagnostics log of the stall watchdog.
+ */
+class DiagnosticsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit DiagnosticsDialog(const StallWatchdog *watchdog, QWidget *parent = nullptr);
+    ~DiagnosticsDialog();
+
+    void refresh();
+
+private:
+    const StallWatchdog *watchdog;
+    std::unique_ptr<QVBoxLayout> layout;
+    std::unique_ptr<QPlainTextEdit> text;
+};
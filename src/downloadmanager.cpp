@@ -0,0 +1,300 @@
+#include "downloadmanager.hpp"
+#include "configmanager.hpp"
+
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QLocale>
+#include <QSet>
+#include <QTimer>
+#include <QDir>
+
+#include <algorithm>
+
+// interval of the throughput samples
+constexpr const int sampleInterval = 1000;
+
+DownloadManager::DownloadManager(ConfigManager *config, QWidget *dialogParent, QObject *parent)
+    : QObject(parent)
+{
+    this->config = config;
+    this->dialogParent = dialogParent;
+
+    this->sampleTimer = std::make_unique<QTimer>();
+    this->sampleTimer->setInterval(sampleInterval);
+    connect(this->sampleTimer.get(), &QTimer::timeout, this, &DownloadManager::sample);
+}
+
+DownloadManager::~DownloadManager()
+{
+    this->sampleTimer->stop();
+}
+
+void DownloadManager::requested(QWebEngineDownloadRequest *download)
+{
+    auto directory = this->config->downloadsLastDirectory();
+    if (directory.isEmpty() || !QFileInfo(directory).isDir())
+    {
+        directory = QDir::homePath();
+    }
+
+    QString filename;
+    if (this->config->downloadsAskForLocation())
+    {
+        filename = QFileDialog::getSaveFileName(this->dialogParent, tr("Download"),
+            QString("%1/%2").arg(directory, download->downloadFileName()));
+    }
+    else
+    {
+        filename = this->uniqueFileName(directory, download->downloadFileName());
+    }
+
+    if (filename.isEmpty())
+    {
+        download->cancel();
+        return;
+    }
+
+    const auto fileinfo = QFileInfo(filename);
+    this->config->setDownloadsLastDirectory(fileinfo.path());
+
+    download->setDownloadDirectory(fileinfo.path());
+    download->setDownloadFileName(fileinfo.fileName());
+
+    const auto id = download->id();
+    const bool queued = this->transferringCount() >= std::max(1, this->config->downloadsMaxConcurrent());
+    auto &item = this->_downloads[id];
+    item.request = download;
+    item.queued = queued;
+
+    connect(download, &QWebEngineDownloadRequest::stateChanged, this, [this, id]{
+        this->stateChanged(id);
+    });
+    connect(download, &QWebEngineDownloadRequest::isPausedChanged, this, &DownloadManager::changed);
+    connect(download, &QWebEngineDownloadRequest::totalBytesChanged, this, &DownloadManager::changed);
+
+    download->accept();
+
+    // accepted downloads must start, queued ones are paused immediately
+    if (item.queued)
+    {
+        download->pause();
+    }
+
+    if (!this->sampleTimer->isActive())
+    {
+        this->sampleTimer->start();
+    }
+
+    emit changed();
+}
+
+void DownloadManager::pause(quint32 id)
+{
+    const auto it = this->_downloads.find(id);
+    if (it != this->_downloads.end() && it->second.request)
+    {
+        it->second.pausedByUser = true;
+        it->second.request->pause();
+        this->startQueued();
+    }
+}
+
+void DownloadManager::resume(quint32 id)
+{
+    const auto it = this->_downloads.find(id);
+    if (it != this->_downloads.end() && it->second.request)
+    {
+        // count the slots while the download still doesn't take one itself
+        const auto transferring = this->transferringCount();
+        it->second.pausedByUser = false;
+
+        // resuming takes a slot if one is free, otherwise the download is queued again
+        if (transferring < std::max(1, this->config->downloadsMaxConcurrent()))
+        {
+            it->second.queued = false;
+            it->second.request->resume();
+        }
+        else
+        {
+            it->second.queued = true;
+        }
+
+        emit changed();
+    }
+}
+
+void DownloadManager::cancel(quint32 id)
+{
+    const auto it = this->_downloads.find(id);
+    if (it != this->_downloads.end() && it->second.request)
+    {
+        it->second.request->cancel();
+    }
+}
+
+const std::map<quint32, DownloadManager::Download> &DownloadManager::downloads() const
+{
+    return this->_downloads;
+}
+
+qint64 DownloadManager::receivedBytes() const
+{
+    qint64 bytes = 0;
+    for (auto&& [id, download] : this->_downloads)
+    {
+        if (download.request)
+        {
+            bytes += download.request->receivedBytes();
+        }
+    }
+    return bytes;
+}
+
+qint64 DownloadManager::totalBytes() const
+{
+    qint64 bytes = 0;
+    for (auto&& [id, download] : this->_downloads)
+    {
+        if (download.request && download.request->totalBytes() > 0)
+        {
+            bytes += download.request->totalBytes();
+        }
+    }
+    return bytes;
+}
+
+double DownloadManager::bytesPerSecond() const
+{
+    double speed = 0;
+    for (auto&& [id, download] : this->_downloads)
+    {
+        if (!download.throughput.isEmpty())
+        {
+            speed += download.throughput.last();
+        }
+    }
+    return speed;
+}
+
+const QString DownloadManager::summary() const
+{
+    if (this->_downloads.empty())
+    {
+        return {};
+    }
+
+    const QLocale locale;
+    const auto total = this->totalBytes();
+    const auto progress = total > 0 ? QString("%1%").arg(this->receivedBytes() * 100 / total) : locale.formattedDataSize(this->receivedBytes());
+
+    return tr("Downloading %n file(s): %1 (%2/s)", nullptr, int(this->_downloads.size()))
+        .arg(progress, locale.formattedDataSize(qint64(this->bytesPerSecond())));
+}
+
+void DownloadManager::stateChanged(quint32 id)
+{
+    const auto it = this->_downloads.find(id);
+    if (it == this->_downloads.end())
+    {
+        return;
+    }
+
+    const auto request = it->second.request;
+    if (!request || request->isFinished())
+    {
+        if (request && request->state() == QWebEngineDownloadRequest::DownloadCompleted)
+        {
+            emit finished(request);
+        }
+
+        this->_downloads.erase(it);
+        this->startQueued();
+
+        if (this->_downloads.empty())
+        {
+            this->sampleTimer->stop();
+        }
+    }
+    else if (request->state() == QWebEngineDownloadRequest::DownloadInProgress && it->second.queued && !request->isPaused())
+    {
+        request->pause();
+    }
+
+    emit changed();
+}
+
+void DownloadManager::sample()
+{
+    for (auto&& [id, download] : this->_downloads)
+    {
+        if (!download.request)
+        {
+            continue;
+        }
+
+        const auto received = download.request->receivedBytes();
+        download.throughput.append(double(received - download.lastReceivedBytes) * 1000 / sampleInterval);
+        download.lastReceivedBytes = received;
+
+        while (download.throughput.size() > historySize)
+        {
+            download.throughput.removeFirst();
+        }
+    }
+
+    emit changed();
+}
+
+void DownloadManager::startQueued()
+{
+    const auto limit = std::max(1, this->config->downloadsMaxConcurrent());
+
+    // downloads are started in the order they were requested
+    for (auto&& [id, download] : this->_downloads)
+    {
+        if (this->transferringCount() >= limit)
+        {
+            break;
+        }
+
+        if (download.queued && !download.pausedByUser && download.request)
+        {
+            download.queued = false;
+            download.request->resume();
+        }
+    }
+}
+
+int DownloadManager::transferringCount() const
+{
+    return int(std::count_if(this->_downloads.begin(), this->_downloads.end(), [](auto&& entry){
+        return entry.second.request && !entry.second.queued && !entry.second.pausedByUser;
+    }));
+}
+
+const QString DownloadManager::uniqueFileName(const QString &directory, const QString &fileName) const
+{
+    // unfinished downloads only create their file once data arrives
+    QSet<QString> reserved;
+    for (auto&& [id, download] : this->_downloads)
+    {
+        if (download.request)
+        {
+            reserved.insert(QDir(download.request->downloadDirectory()).filePath(download.request->downloadFileName()));
+        }
+    }
+
+    // dot files like .bashrc have no extension
+    const QFileInfo info(fileName);
+    const auto baseName = info.completeBaseName().isEmpty() ? fileName : info.completeBaseName();
+    const auto suffix = info.completeBaseName().isEmpty() || info.suffix().isEmpty() ? QString() : "." + info.suffix();
+
+    // append a counter before the extension until the name is free
+    auto candidate = QDir(directory).filePath(fileName);
+    for (auto i = 1; QFileInfo::exists(candidate) || reserved.contains(candidate); ++i)
+    {
+        candidate = QDir(directory).filePath(QString("%1 (%2)%3").arg(baseName, QString::number(i), suffix));
+    }
+
+    return candidate;
+}
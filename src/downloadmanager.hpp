@@ -0,0 +1,81 @@
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QList>
+#include <QWebEngineDownloadRequest>
+
+#include <map>
+#include <memory>
+
+class QWidget;
+class QTimer;
+class ConfigManager;
+
+/**
+ * Queues downloads of a profile and tracks their progress.
+ *
+ * At most downloads/maxConcurrent downloads are transferring at the same
+ * time, additional downloads are accepted but paused until a slot is free.
+ */
+class DownloadManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DownloadManager(ConfigManager *config, QWidget *dialogParent, QObject *parent = nullptr);
+    ~DownloadManager();
+
+    struct Download
+    {
+        QPointer<QWebEngineDownloadRequest> request;
+        bool queued = false;
+        bool pausedByUser = false;
+        qint64 lastReceivedBytes = 0;
+        QList<double> throughput; // bytes/s, one sample per second
+    };
+
+    // samples of the throughput history kept per download
+    static constexpr const int historySize = 60;
+
+    /**
+     * Handler for QWebEngineProfile::downloadRequested.
+     */
+    void requested(QWebEngineDownloadRequest *download);
+
+    void pause(quint32 id);
+    void resume(quint32 id);
+    void cancel(quint32 id);
+
+    /**
+     * Unfinished downloads, including queued and paused ones.
+     */
+    const std::map<quint32, Download> &downloads() const;
+
+    qint64 receivedBytes() const;
+    qint64 totalBytes() const;
+    double bytesPerSecond() const;
+
+    /**
+     * Short human readable status for the tray icon, empty when idle.
+     */
+    const QString summary() const;
+
+signals:
+    void changed();
+    void finished(QWebEngineDownloadRequest *download);
+
+private:
+    void stateChanged(quint32 id);
+    void sample();
+    void startQueued();
+    int transferringCount() const;
+
+    // a free file name in directory, also not used by an unfinished download
+    const QString uniqueFileName(const QString &directory, const QString &fileName) const;
+
+    ConfigManager *config;
+    QWidget *dialogParent;
+    std::unique_ptr<QTimer> sampleTimer;
+    std::map<quint32, Download> _downloads;
+};
@@ -1,51 +1,290 @@
 #include "elementurlscheme.hpp"
+#include "trace.hpp"
 
 #include <QWebEngineUrlRequestJob>
 #include <QFile>
 #include <QFileInfo>
+#include <QSaveFile>
+#include <QBuffer>
+#include <QDateTime>
 #include <QMimeDatabase>
+#include <QRegularExpression>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QTimer>
+#include <QDir>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+#include <QDebug>
+
+// files requested within this time after index.html are preloaded on the next start
+constexpr const int learningWindow = 10000;
+constexpr const qsizetype maxPreloadHints = 32;
+
+// an update of the web app changes many files, wait until it settles
+constexpr const int updateDelay = 1000;
+
+// answers the config requests of element-web from the inlined files, %1 maps
+// file names to their contents or null for files which don't exist
+static const char *configShim = R"(<script>(() => {
+const configs = %1;
+const fetch = window.fetch;
+window.fetch = function(input, init) {
+    const url = new URL(typeof input === "string" ? input : input.url, location.href);
+    const name = url.pathname.substring(1);
+    if (url.protocol === location.protocol && url.host === location.host && Object.prototype.hasOwnProperty.call(configs, name)) {
+        return Promise.resolve(configs[name] === null ?
+            new Response("", {status: 404}) :
+            new Response(configs[name], {status: 200, headers: {"Content-Type": "application/json"}}));
+    }
+    return fetch.apply(this, arguments);
+};
+})();</script>
+)";
+
+// converts a string into a JavaScript string literal which is safe inside of a script element
+static QString stringLiteral(const QString &value)
+{
+    const auto array = QJsonDocument(QJsonArray{value}).toJson(QJsonDocument::Compact);
+    return QString::fromUtf8(array.mid(1, array.size() - 2)).replace("</", "<\\/");
+}
+
+static bool isConfig(const QString &path)
+{
+    return path.startsWith("config.") && path.endsWith(".json");
+}
 
 ElementUrlScheme::ElementUrlScheme(const QString &root, QObject *parent)
-    : QWebEngineUrlSchemeHandler(parent),
-      root(root)
+    : QWebEngineUrlSchemeHandler(parent)
 {
+    this->updateTimer = std::make_unique<QTimer>();
+    this->updateTimer->setSingleShot(true);
+    this->updateTimer->setInterval(updateDelay);
+    connect(this->updateTimer.get(), &QTimer::timeout, this, &ElementUrlScheme::update);
+
+    this->watcher = std::make_unique<QFileSystemWatcher>();
+    connect(this->watcher.get(), &QFileSystemWatcher::directoryChanged, this->updateTimer.get(), qOverload<>(&QTimer::start));
+
+    this->changeRoot(root);
+}
+
+ElementUrlScheme::~ElementUrlScheme()
+{
+    this->updateTimer->stop();
 }
 
 void ElementUrlScheme::changeRoot(const QString &newRoot)
 {
     this->root = newRoot;
+    this->watch();
+    this->update();
 }
 
-void ElementUrlScheme::requestStarted(QWebEngineUrlRequestJob *request)
+int ElementUrlScheme::generation() const
 {
-    // check if directory exists with every request in case it is moved or deleted
-    if (!QFileInfo(root).isDir())
+    return this->current.number;
+}
+
+const QString &ElementUrlScheme::version() const
+{
+    return this->current.version;
+}
+
+void ElementUrlScheme::update()
+{
+    const auto path = ElementUrlScheme::resolve(this->root);
+    this->rootValid = !this->current.path.isEmpty() && QFileInfo(this->current.path).isDir();
+
+    // the directory may have been created after the webroot was watched
+    if (this->watcher->directories().isEmpty())
+    {
+        this->watch();
+    }
+
+    if (path.isEmpty() || path == this->pending.path)
     {
-        request->fail(QWebEngineUrlRequestJob::UrlNotFound);
+        return;
     }
 
+    // the update was reverted before the page was reloaded
+    if (path == this->current.path)
+    {
+        this->pending = {};
+        this->pendingReady = false;
+        return;
+    }
+
+    QFile versionFile(QString("%1/%2").arg(path, "version"));
+    const auto version = versionFile.open(QIODevice::ReadOnly | QIODevice::Text) ?
+        QString::fromUtf8(versionFile.readAll()).trimmed() : QFileInfo(path).fileName();
+    const Generation generation{++this->lastGeneration, path, version};
+
+    // nothing to keep consistent when no page was loaded or the files are gone
+    if (!this->pageLoaded || !this->rootValid)
+    {
+        this->switchTo(generation);
+        return;
+    }
+
+    qDebug() << "element:// prewarming generation" << generation.number << "version" << version << "from" << path;
+    this->pending = generation;
+    this->pendingReady = false;
+
+    // read the hot files once on a worker thread, the page cache serves them on the next load
+    auto watcher = new QFutureWatcher<qint64>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, number = generation.number]{
+        watcher->deleteLater();
+        if (this->pending.number != number)
+        {
+            return;
+        }
+
+        qDebug() << "element:// generation" << number << "is warm," << watcher->result() << "bytes read";
+        this->pendingReady = true;
+        emit upgradeReady(this->pending.version);
+    });
+    watcher->setFuture(QtConcurrent::run(&ElementUrlScheme::prewarm, path, this->preloadHints));
+}
+
+void ElementUrlScheme::switchTo(const Generation &generation)
+{
+    qDebug() << "element:// serving generation" << generation.number << "version" << generation.version << "from" << generation.path;
+    this->current = generation;
+    this->rootValid = QFileInfo(this->current.path).isDir();
+    this->pending = {};
+    this->pendingReady = false;
+}
+
+void ElementUrlScheme::watch()
+{
+    // the parent notices when the webroot itself is a symlink which is replaced
+    if (!this->watcher->directories().isEmpty())
+    {
+        this->watcher->removePaths(this->watcher->directories());
+    }
+
+    const QFileInfo info(this->root);
+    for (auto&& directory : {this->root, info.absolutePath()})
+    {
+        if (QFileInfo(directory).isDir())
+        {
+            this->watcher->addPath(directory);
+        }
+    }
+}
+
+void ElementUrlScheme::setOptimizeIndex(bool enabled)
+{
+    this->optimizeIndex = enabled;
+    this->indexRevision.clear();
+}
+
+void ElementUrlScheme::setPreloadHintsFile(const QString &file)
+{
+    this->preloadHintsFile = file;
+    this->hintsRevision.clear();
+}
+
+void ElementUrlScheme::requestStarted(QWebEngineUrlRequestJob *request)
+{
+#ifdef STARTUP_TRACING_ENABLED
+    if (this->requestCount == 0)
+    {
+        TRACE_INSTANT("first element:// request");
+    }
+    TRACE_COUNTER("element:// requests", ++this->requestCount);
+#endif
     // normalize path
     const auto path = ElementUrlScheme::getFilePath(request->requestUrl());
-    const auto fullPath = QString("%1/%2").arg(root, path);
 
-    // check if file exists
-    if (!QFileInfo::exists(fullPath))
+    // a page load picks up a warm generation, all further requests of the page are served from it
+    if (path == "index.html")
     {
-        request->fail(QWebEngineUrlRequestJob::UrlNotFound);
+        if (this->pendingReady)
+        {
+            this->switchTo(this->pending);
+        }
+        this->pageLoaded = true;
     }
 
-    // prepare file for reading
+    if (!this->rootValid)
+    {
+        // the directory may have been created or replaced in the meantime
+        this->update();
+        if (!this->rootValid && this->pending.number)
+        {
+            this->switchTo(this->pending);
+        }
+        if (!this->rootValid)
+        {
+            request->fail(QWebEngineUrlRequestJob::UrlNotFound);
+            return;
+        }
+    }
+
+    const auto fullPath = QString("%1/%2").arg(this->current.path, path);
+
+    // the transformed index.html is kept in memory, the file is served on errors
+    if (path == "index.html" && this->optimizeIndex)
+    {
+        const auto html = this->indexPage(request->requestUrl().host());
+        if (!html.isEmpty())
+        {
+            auto buffer = new QBuffer(this);
+            buffer->setData(html);
+            buffer->open(QIODevice::ReadOnly);
+            connect(request, &QObject::destroyed, buffer, &QObject::deleteLater);
+
+            TRACE_COUNTER("element:// bytes", this->bytesServed += html.size());
+            request->reply("text/html", buffer);
+            emit requestHandled(request->requestUrl());
+            return;
+        }
+    }
+    else if (this->learning)
+    {
+        this->learn(path);
+    }
+
+    // prepare file for reading, opening the file is the only filesystem access
+    // on success, the reason is only looked up when it fails
     auto file = new QFile(fullPath, this);
     connect(request, &QObject::destroyed, file, &QObject::deleteLater);
 
     if (!file->open(QIODevice::ReadOnly))
     {
-        // permission denied reading file, respond with request denied
-        request->fail(QWebEngineUrlRequestJob::RequestDenied);
+        if (file->exists())
+        {
+            // permission denied reading file, respond with request denied
+            request->fail(QWebEngineUrlRequestJob::RequestDenied);
+        }
+        else
+        {
+            // check if the directory was moved or deleted
+            this->rootValid = QFileInfo(this->current.path).isDir();
+            request->fail(QWebEngineUrlRequestJob::UrlNotFound);
+        }
+        return;
     }
 
+    TRACE_COUNTER("element:// bytes", this->bytesServed += file->size());
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 6, 0)
+    // the service worker controls the whole app and its updates must not be cached,
+    // Chromium fetches it again when the page loads and compares it byte by byte
+    if (request->requestHeaders().value("Service-Worker") == "script")
+    {
+        request->setAdditionalResponseHeaders({
+            {"Service-Worker-Allowed", "/"},
+            {"Cache-Control", "no-cache"},
+        });
+    }
+#endif
+
     // send file
     request->reply(ElementUrlScheme::mimeType(fullPath), file);
+    emit requestHandled(request->requestUrl());
 }
 
 const QString ElementUrlScheme::getFilePath(const QUrl &url)
@@ -68,6 +307,246 @@ const QString ElementUrlScheme::getFilePath(const QUrl &url)
 
 const QByteArray ElementUrlScheme::mimeType(const QString &path)
 {
+    // scripts must have a JavaScript type for Chromium to register them as service
+    // worker and wasm needs its own type for streaming compilation, regardless of
+    // the version of the mime database
+    if (path.endsWith(".js") || path.endsWith(".mjs"))
+    {
+        return "text/javascript";
+    }
+    if (path.endsWith(".wasm"))
+    {
+        return "application/wasm";
+    }
+    if (path.endsWith(".json"))
+    {
+        return "application/json";
+    }
+
+    // the web app has proper file extensions, don't read the file contents
     const QMimeDatabase db;
-    return db.mimeTypeForFile(path).name().toUtf8();
+    return db.mimeTypeForFile(path, QMimeDatabase::MatchExtension).name().toUtf8();
+}
+
+const QString ElementUrlScheme::revision(const QString &host) const
+{
+    // any change of the files which end up in the transformed page starts a new revision
+    QStringList parts{this->current.path};
+    for (auto&& name : {QString("index.html"), QString("config.json"), QString("config.%1.json").arg(host)})
+    {
+        const QFileInfo info(QString("%1/%2").arg(this->current.path, name));
+        parts << (info.exists() ? QString("%1@%2").arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch()) : "-");
+    }
+    return parts.join(':');
+}
+
+const QByteArray ElementUrlScheme::indexPage(const QString &host)
+{
+    const auto revision = this->revision(host);
+    this->loadPreloadHints(revision);
+
+    // learn the files requested during startup once per revision
+    if (this->hintsRevision != revision && !this->learning)
+    {
+        this->learning = true;
+        this->learnedHints.clear();
+        QTimer::singleShot(learningWindow, this, [this, revision]{
+            this->finishLearning(revision);
+        });
+    }
+
+    if (revision == this->indexRevision)
+    {
+        return this->indexHtml;
+    }
+
+    QFile file(QString("%1/%2").arg(this->current.path, "index.html"));
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return {};
+    }
+    auto html = QString::fromUtf8(file.readAll());
+
+    static const QRegularExpression head("<head\\b[^>]*>", QRegularExpression::CaseInsensitiveOption);
+    const auto headMatch = head.match(html);
+    if (headMatch.hasMatch())
+    {
+        // inline all config files element-web asks for, missing files are answered with 404
+        QStringList configs;
+        for (auto&& name : {QString("config.json"), QString("config.%1.json").arg(host)})
+        {
+            QFile config(QString("%1/%2").arg(this->current.path, name));
+            configs << QString("%1: %2").arg(stringLiteral(name),
+                config.open(QIODevice::ReadOnly) ? stringLiteral(QString::fromUtf8(config.readAll())) : "null");
+        }
+        auto inject = QString(configShim).arg("{" + configs.join(", ") + "}");
+
+        // bundles referenced by the page itself and the files learned from previous starts
+        const auto module = html.contains("type=\"module\"");
+        auto hints = ElementUrlScheme::references(html);
+        hints << this->preloadHints;
+        hints.removeDuplicates();
+
+        for (auto&& hint : hints)
+        {
+            inject += ElementUrlScheme::preloadLink(hint, module);
+        }
+
+        html.insert(headMatch.capturedEnd(), "\n" + inject);
+    }
+
+    this->indexRevision = revision;
+    this->indexHtml = html.toUtf8();
+    return this->indexHtml;
+}
+
+void ElementUrlScheme::loadPreloadHints(const QString &revision)
+{
+    if (this->hintsRevision == revision || this->preloadHintsFile.isEmpty())
+    {
+        return;
+    }
+
+    // the first line is the revision the hints were learned for
+    QFile file(this->preloadHintsFile);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return;
+    }
+
+    auto lines = QString::fromUtf8(file.readAll()).split('\n', Qt::SkipEmptyParts);
+    if (!lines.isEmpty() && lines.takeFirst() == revision)
+    {
+        this->hintsRevision = revision;
+        this->preloadHints = lines;
+    }
+}
+
+void ElementUrlScheme::learn(const QString &path)
+{
+    if (this->learnedHints.size() < maxPreloadHints && !isConfig(path) &&
+        !ElementUrlScheme::preloadLink(path, false).isEmpty() && !this->learnedHints.contains(path))
+    {
+        this->learnedHints.append(path);
+    }
+}
+
+void ElementUrlScheme::finishLearning(const QString &revision)
+{
+    this->learning = false;
+    this->hintsRevision = revision;
+    this->preloadHints = this->learnedHints;
+
+    // the next load gets the learned hints
+    this->indexRevision.clear();
+    qDebug() << "element:// learned" << this->preloadHints.size() << "preload hints";
+
+    if (!this->preloadHintsFile.isEmpty())
+    {
+        QSaveFile file(this->preloadHintsFile);
+        if (file.open(QIODevice::WriteOnly | QIODevice::Text))
+        {
+            file.write(QString("%1\n%2\n").arg(revision, this->preloadHints.join('\n')).toUtf8());
+            file.commit();
+        }
+    }
+}
+
+const QString ElementUrlScheme::preloadLink(const QString &path, bool module)
+{
+    // destination of the preload by file type, files which are fetched need the
+    // same credentials mode as the later request to be used from the preload cache
+    static const QHash<QString, QString> destinations = {
+        {"js",    "script"},
+        {"css",   "style"},
+        {"json",  "fetch"},
+        {"wasm",  "fetch"},
+        {"woff2", "font"},
+        {"woff",  "font"},
+        {"ttf",   "font"},
+    };
+
+    const auto suffix = path.section('.', -1).section('?', 0, 0).toLower();
+    const auto destination = destinations.value(suffix);
+    if (destination.isEmpty() || path == "index.html")
+    {
+        return {};
+    }
+
+    const auto escaped = path.toHtmlEscaped();
+    if (destination == "script" && module)
+    {
+        return QString("<link rel=\"modulepreload\" href=\"%1\">\n").arg(escaped);
+    }
+
+    const auto crossorigin = destination == "fetch" || destination == "font";
+    return QString("<link rel=\"preload\" href=\"%1\" as=\"%2\"%3>\n").arg(escaped, destination, crossorigin ? " crossorigin" : "");
+}
+
+const QStringList ElementUrlScheme::references(const QString &html)
+{
+    // scripts and stylesheets of the web app, relative to the webroot
+    static const QRegularExpression references("<(?:script\\b[^>]*\\bsrc|link\\b[^>]*\\bhref)=\"([^\"]+)\"",
+        QRegularExpression::CaseInsensitiveOption);
+
+    QStringList paths;
+    auto it = references.globalMatch(html);
+    while (it.hasNext())
+    {
+        auto path = it.next().captured(1);
+        if (path.contains("//") || !(path.endsWith(".js") || path.endsWith(".css")))
+        {
+            continue;
+        }
+        if (path.startsWith("./"))
+        {
+            path.remove(0, 2);
+        }
+        else if (path.startsWith('/'))
+        {
+            path.remove(0, 1);
+        }
+        paths << path;
+    }
+    return paths;
+}
+
+const QString ElementUrlScheme::resolve(const QString &root)
+{
+    // versioned webroots point to the active web app with a current symlink
+    const QFileInfo current(QString("%1/%2").arg(root, "current"));
+    const auto path = current.isDir() ? current.canonicalFilePath() : QFileInfo(root).canonicalFilePath();
+    return QFileInfo(path).isDir() ? path : QString();
+}
+
+qint64 ElementUrlScheme::prewarm(const QString &path, const QStringList &hints)
+{
+    // the page itself, its config, its bundles and the files learned for the previous generation
+    QStringList files{"index.html", "config.json"};
+    QFile index(QString("%1/%2").arg(path, "index.html"));
+    if (index.open(QIODevice::ReadOnly))
+    {
+        files << ElementUrlScheme::references(QString::fromUtf8(index.readAll()));
+    }
+    files << hints;
+    files << QDir(path).entryList({"*.wasm"}, QDir::Files);
+    files.removeDuplicates();
+
+    qint64 bytes = 0;
+    QByteArray buffer(1024 * 1024, Qt::Uninitialized);
+    for (auto&& name : files)
+    {
+        QFile file(QString("%1/%2").arg(path, name));
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            continue;
+        }
+
+        qint64 read = 0;
+        while ((read = file.read(buffer.data(), buffer.size())) > 0)
+        {
+            bytes += read;
+        }
+    }
+    return bytes;
 }
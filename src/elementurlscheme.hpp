@@ -2,15 +2,48 @@
 
 #include <QWebEngineUrlSchemeHandler>
 
+#include <memory>
+
+class QFileSystemWatcher;
+class QTimer;
+
+/**
+ * Serves the web app on element://.
+ *
+ * The webroot is either the web app itself or a directory of versioned web
+ * apps with a current symlink to the active one (webapp-<version>/ and
+ * current -> webapp-<version>). Every directory the webroot resolves to is
+ * a new generation. A new generation is prewarmed in the background and the
+ * pages stay on their generation until the next page load, so the files of
+ * a page never come from two versions.
+ */
 class ElementUrlScheme : public QWebEngineUrlSchemeHandler
 {
     Q_OBJECT
 
 public:
     ElementUrlScheme(const QString &root, QObject *parent = nullptr);
+    ~ElementUrlScheme();
 
     void changeRoot(const QString &newRoot);
 
+    // generation the pages are served from and its element-web version
+    int generation() const;
+    const QString &version() const;
+
+    /**
+     * Serves index.html with config.json inlined and preload hints for the
+     * bundles, so element-web doesn't discover them one after another.
+     * The page is transformed once per revision of the files it contains.
+     */
+    void setOptimizeIndex(bool enabled);
+
+    /**
+     * Remembers the files requested while the web app starts in this file,
+     * they are preloaded from index.html on the next start of the same revision.
+     */
+    void setPreloadHintsFile(const QString &file);
+
     static const QByteArray schemeName()
     {
         return "element";
@@ -18,9 +51,64 @@ public:
 
     void requestStarted(QWebEngineUrlRequestJob *request) override;
 
+signals:
+    // emitted after a file was handed to QtWebEngine
+    void requestHandled(const QUrl &url);
+
+    // a new generation is prewarmed, the next page load switches to it
+    void upgradeReady(const QString &version);
+
 private:
+    // drives the private hot paths without QtWebEngine
+    friend class PgoTraining;
+
+    struct Generation
+    {
+        int number = 0;
+        QString path;
+        QString version;
+    };
+
     QString root;
+    Generation current;
+    Generation pending;
+    bool rootValid = false;
+    bool pendingReady = false;
+    bool pageLoaded = false;
+    int lastGeneration = 0;
+
+    std::unique_ptr<QFileSystemWatcher> watcher;
+    std::unique_ptr<QTimer> updateTimer;
+
+    bool optimizeIndex = true;
+    QString indexRevision;
+    QByteArray indexHtml;
+
+    QString preloadHintsFile;
+    QString hintsRevision;
+    QStringList preloadHints;
+    QStringList learnedHints;
+    bool learning = false;
+
+    void update();
+    void switchTo(const Generation &generation);
+    void watch();
+
+    const QString revision(const QString &host) const;
+    const QByteArray indexPage(const QString &host);
+    void loadPreloadHints(const QString &revision);
+    void learn(const QString &path);
+    void finishLearning(const QString &revision);
+
+#ifdef STARTUP_TRACING_ENABLED
+    qint64 requestCount = 0;
+    qint64 bytesServed = 0;
+#endif
 
     static const QString getFilePath(const QUrl &url);
     static const QByteArray mimeType(const QString &path);
+    static const QString preloadLink(const QString &path, bool module);
+    static const QStringList references(const QString &html);
+    static const QString resolve(const QString &root);
+    static qint64 prewarm(const QString &path, const QStringList &hints);
 };
@@ -0,0 +1,184 @@
+#include "engineoptions.hpp"
+#include "configmanager.hpp"
+#include "httpcache.hpp"
+
+#include <QDebug>
+
+static const QStringList processModels = {
+    "default",
+    "process-per-site",
+    "process-per-site-instance",
+    "single-process",
+};
+
+// valid ranges of the numeric options
+constexpr const int maxRendererProcessLimit = 64;
+constexpr const int minJsHeapLimit = 128;
+constexpr const int maxJsHeapLimit = 16384;
+constexpr const int maxRasterThreads = 4; // hard limit enforced by Chromium
+constexpr const int maxHttpCacheSize = 8192;
+
+EngineOptions::EngineOptions(const ConfigManager *config)
+{
+    const auto preset = config->enginePreset();
+    if (!EngineOptions::applyPreset(preset, this->_settings))
+    {
+        qWarning() << "engine: unknown preset" << preset << "- using defaults";
+    }
+
+    // explicit keys override the preset
+    const auto processModel = config->engineProcessModel();
+    if (processModel != "default")
+    {
+        if (processModels.contains(processModel))
+        {
+            this->_settings.processModel = processModel;
+        }
+        else
+        {
+            qWarning() << "engine: ignoring invalid process model" << processModel;
+        }
+    }
+
+    const auto rendererProcessLimit = config->engineRendererProcessLimit();
+    if (rendererProcessLimit != 0)
+    {
+        if (rendererProcessLimit > 0 && rendererProcessLimit <= maxRendererProcessLimit)
+        {
+            this->_settings.rendererProcessLimit = rendererProcessLimit;
+        }
+        else
+        {
+            qWarning() << "engine: ignoring invalid renderer process limit" << rendererProcessLimit;
+        }
+    }
+
+    const auto jsHeapLimit = config->engineJsHeapLimit();
+    if (jsHeapLimit != 0)
+    {
+        if (jsHeapLimit >= minJsHeapLimit && jsHeapLimit <= maxJsHeapLimit)
+        {
+            this->_settings.jsHeapLimit = jsHeapLimit;
+        }
+        else
+        {
+            qWarning() << "engine: ignoring invalid js heap limit" << jsHeapLimit;
+        }
+    }
+
+    const auto rasterThreads = config->engineRasterThreads();
+    if (rasterThreads != 0)
+    {
+        if (rasterThreads > 0 && rasterThreads <= maxRasterThreads)
+        {
+            this->_settings.rasterThreads = rasterThreads;
+        }
+        else
+        {
+            qWarning() << "engine: ignoring invalid raster thread count" << rasterThreads;
+        }
+    }
+
+    if (!config->engineGpuCompositing())
+    {
+        this->_settings.gpuCompositing = false;
+    }
+
+    const auto httpCacheSize = config->engineHttpCacheSize();
+    if (httpCacheSize != 0)
+    {
+        if (httpCacheSize > 0 && httpCacheSize <= maxHttpCacheSize)
+        {
+            this->_settings.httpCacheSize = httpCacheSize;
+        }
+        else
+        {
+            qWarning() << "engine: ignoring invalid http cache size" << httpCacheSize;
+        }
+    }
+
+    // build Chromium switches
+    if (this->_settings.processModel != "default")
+    {
+        this->_arguments << "--" + this->_settings.processModel;
+    }
+    if (this->_settings.rendererProcessLimit > 0)
+    {
+        this->_arguments << QString("--renderer-process-limit=%1").arg(this->_settings.rendererProcessLimit);
+    }
+    if (this->_settings.jsHeapLimit > 0)
+    {
+        this->_arguments << QString("--js-flags=--max-old-space-size=%1").arg(this->_settings.jsHeapLimit);
+    }
+    if (this->_settings.rasterThreads > 0)
+    {
+        this->_arguments << QString("--num-raster-threads=%1").arg(this->_settings.rasterThreads);
+    }
+    if (!this->_settings.gpuCompositing)
+    {
+        this->_arguments << "--disable-gpu-compositing";
+    }
+
+    // the shader cache is written next to the persistent storage, keep it
+    // off slow (network) home directories together with the HTTP cache
+    if (HttpCache::parseType(config->cacheType()) != HttpCache::Type::Disk)
+    {
+        this->_arguments << "--disable-gpu-shader-disk-cache";
+    }
+}
+
+const QStringList EngineOptions::presets()
+{
+    return {"default", "low-memory", "throughput", "software-rendering"};
+}
+
+bool EngineOptions::applyPreset(const QString &name, Settings &settings)
+{
+    if (name == "default")
+    {
+        settings = Settings{};
+    }
+    else if (name == "low-memory")
+    {
+        // share renderers between tabs of the same site and keep the V8 heap small
+        settings.processModel = "process-per-site";
+        settings.rendererProcessLimit = 1;
+        settings.jsHeapLimit = 512;
+        settings.rasterThreads = 1;
+        settings.httpCacheSize = 64;
+    }
+    else if (name == "throughput")
+    {
+        // large heap avoids GC pressure in big accounts, more raster threads for scrolling
+        settings.jsHeapLimit = 4096;
+        settings.rasterThreads = 4;
+        settings.httpCacheSize = 512;
+    }
+    else if (name == "software-rendering")
+    {
+        // hosts without a usable GPU (VMs, remote desktops)
+        settings.gpuCompositing = false;
+        settings.rasterThreads = 2;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+const EngineOptions::Settings &EngineOptions::settings() const
+{
+    return this->_settings;
+}
+
+const QStringList &EngineOptions::arguments() const
+{
+    return this->_arguments;
+}
+
+qint64 EngineOptions::httpCacheSize() const
+{
+    return qint64(this->_settings.httpCacheSize) * 1024 * 1024;
+}
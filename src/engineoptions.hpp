@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+class ConfigManager;
+
+/**
+ * Translates the [engine] section of the preferences into Chromium
+ * command line switches. Must be constructed before QApplication,
+ * QtWebEngine only parses the switches once on initialization.
+ */
+class EngineOptions
+{
+public:
+    explicit EngineOptions(const ConfigManager *config);
+
+    /**
+     * Resolved engine settings. A preset provides the base values,
+     * every key which is not left at its default in the config file
+     * overrides the value of the preset.
+     */
+    struct Settings
+    {
+        QString processModel = "default";
+        int rendererProcessLimit = 0;    // 0 = Chromium default
+        int jsHeapLimit = 0;             // MiB, 0 = V8 default
+        int rasterThreads = 0;           // 0 = Chromium default
+        bool gpuCompositing = true;
+        int httpCacheSize = 0;           // MiB, 0 = QtWebEngine default
+    };
+
+    /**
+     * Names of the built-in presets.
+     */
+    static const QStringList presets();
+
+    /**
+     * Validated settings after applying the preset.
+     */
+    const Settings &settings() const;
+
+    /**
+     * Chromium switches to append to the arguments of QApplication.
+     */
+    const QStringList &arguments() const;
+
+    /**
+     * Maximum size of the HTTP cache in bytes, 0 leaves the default.
+     */
+    qint64 httpCacheSize() const;
+
+private:
+    static bool applyPreset(const QString &name, Settings &settings);
+
+    Settings _settings;
+    QStringList _arguments;
+};
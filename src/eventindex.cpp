@@ -0,0 +1,717 @@
+#include "eventindex.hpp"
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QJsonDocument>
+#include <QRegularExpression>
+#include <QDirIterator>
+#include <QTimer>
+#include <QDir>
+#include <QDebug>
+
+#include <algorithm>
+#include <limits>
+
+// live events are written when this many are pending or after the delay
+constexpr const qsizetype liveBatchSize = 500;
+constexpr const int liveFlushDelay = 2000;
+
+// upper bounds of the search arguments, keeps the memory of a single search small
+constexpr const int maxSearchLimit = 100;
+constexpr const int maxContextLimit = 20;
+
+static const QStringList schema = {
+    // the page cache is bounded, the default grows with the database
+    "PRAGMA journal_mode=WAL",
+    "PRAGMA synchronous=NORMAL",
+    "PRAGMA cache_size=-16384",
+    "PRAGMA journal_size_limit=67108864",
+
+    "CREATE TABLE IF NOT EXISTS events ("
+        "id INTEGER PRIMARY KEY, "
+        "event_id TEXT NOT NULL UNIQUE, "
+        "room_id TEXT NOT NULL, "
+        "sender TEXT, "
+        "server_ts INTEGER NOT NULL, "
+        "has_url INTEGER NOT NULL, "
+        "content_value TEXT, "
+        "source TEXT NOT NULL, "
+        "profile TEXT)",
+    "CREATE INDEX IF NOT EXISTS events_room ON events (room_id, server_ts)",
+
+    // external content table, the text is only stored once in events
+    "CREATE VIRTUAL TABLE IF NOT EXISTS events_fts USING fts5("
+        "content_value, content='events', content_rowid='id', tokenize='unicode61 remove_diacritics 2')",
+    "CREATE TRIGGER IF NOT EXISTS events_insert AFTER INSERT ON events BEGIN "
+        "INSERT INTO events_fts (rowid, content_value) VALUES (new.id, new.content_value); END",
+    "CREATE TRIGGER IF NOT EXISTS events_delete AFTER DELETE ON events BEGIN "
+        "INSERT INTO events_fts (events_fts, rowid, content_value) VALUES ('delete', old.id, old.content_value); END",
+
+    "CREATE TABLE IF NOT EXISTS checkpoints ("
+        "room_id TEXT NOT NULL, token TEXT NOT NULL, full_crawl INTEGER NOT NULL, direction TEXT NOT NULL, "
+        "PRIMARY KEY (room_id, token, direction))",
+    "CREATE TABLE IF NOT EXISTS meta (key TEXT PRIMARY KEY, value)",
+};
+
+static const QString toJson(const QVariant &value)
+{
+    return QString::fromUtf8(QJsonDocument::fromVariant(value).toJson(QJsonDocument::Compact));
+}
+
+static const QVariant fromJson(const QVariant &json)
+{
+    return QJsonDocument::fromJson(json.toString().toUtf8()).toVariant();
+}
+
+EventIndexDatabase::EventIndexDatabase(const QString &directory)
+{
+    this->directory = directory;
+    this->connectionName = QString("eventindex-%1").arg(quintptr(this), 0, 16);
+}
+
+EventIndexDatabase::~EventIndexDatabase()
+{
+    this->close();
+}
+
+bool EventIndexDatabase::open()
+{
+    if (this->isOpen())
+    {
+        return true;
+    }
+
+    if (!QDir().mkpath(this->directory))
+    {
+        return this->fail("unable to create", this->directory);
+    }
+
+    {
+        auto db = QSqlDatabase::addDatabase("QSQLITE", this->connectionName);
+        db.setDatabaseName(QString("%1/%2").arg(this->directory, "events.db"));
+        if (!db.open())
+        {
+            this->_lastError = db.lastError().text();
+        }
+    }
+
+    if (!this->isOpen())
+    {
+        QSqlDatabase::removeDatabase(this->connectionName);
+        return this->fail("unable to open", this->_lastError);
+    }
+
+    for (auto&& statement : schema)
+    {
+        // fails when SQLite was built without FTS5
+        if (!this->exec(statement))
+        {
+            this->close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void EventIndexDatabase::close()
+{
+    if (!QSqlDatabase::contains(this->connectionName))
+    {
+        return;
+    }
+
+    {
+        auto db = this->database();
+        if (db.isOpen())
+        {
+            // leave a small database behind, the WAL is only truncated when nobody reads
+            QSqlQuery(db).exec("PRAGMA wal_checkpoint(TRUNCATE)");
+            db.close();
+        }
+    }
+
+    QSqlDatabase::removeDatabase(this->connectionName);
+}
+
+bool EventIndexDatabase::isOpen() const
+{
+    return QSqlDatabase::contains(this->connectionName) && this->database().isOpen();
+}
+
+bool EventIndexDatabase::remove()
+{
+    this->close();
+    return QDir(this->directory).removeRecursively();
+}
+
+const QString &EventIndexDatabase::lastError() const
+{
+    return this->_lastError;
+}
+
+void EventIndexDatabase::clearError()
+{
+    this->_lastError.clear();
+}
+
+int EventIndexDatabase::addEvents(const QVariantList &events, const QVariantMap &checkpoint, const QVariantMap &oldCheckpoint)
+{
+    auto db = this->database();
+    if (!db.transaction())
+    {
+        this->fail("unable to start transaction", db.lastError().text());
+        return -1;
+    }
+
+    QSqlQuery insert(db);
+    insert.prepare("INSERT OR IGNORE INTO events (event_id, room_id, sender, server_ts, has_url, content_value, source, profile) "
+                   "VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+
+    int added = 0;
+    for (auto&& item : events)
+    {
+        const auto map = item.toMap();
+        const auto event = map.value("event").toMap();
+        const auto content = event.value("content").toMap();
+        const auto type = event.value("type").toString();
+
+        // the same text as Seshat indexes
+        const auto value = type == "m.room.name" ? content.value("name").toString() :
+                           type == "m.room.topic" ? content.value("topic").toString() :
+                           content.value("body").toString();
+        const auto hasUrl = content.contains("url") || content.contains("file");
+
+        const auto eventId = event.value("event_id").toString();
+        const auto roomId = event.value("room_id").toString();
+        if (eventId.isEmpty() || roomId.isEmpty() || (value.isEmpty() && !hasUrl))
+        {
+            continue;
+        }
+
+        insert.addBindValue(eventId);
+        insert.addBindValue(roomId);
+        insert.addBindValue(event.value("sender").toString());
+        insert.addBindValue(event.value("origin_server_ts").toLongLong());
+        insert.addBindValue(hasUrl);
+        insert.addBindValue(value);
+        insert.addBindValue(toJson(event));
+        insert.addBindValue(toJson(map.value("profile")));
+        if (!insert.exec())
+        {
+            db.rollback();
+            this->fail("unable to add event", insert.lastError().text());
+            return -1;
+        }
+        added += insert.numRowsAffected();
+    }
+
+    if ((!oldCheckpoint.isEmpty() && !this->removeCheckpoint(oldCheckpoint)) ||
+        (!checkpoint.isEmpty() && !this->addCheckpoint(checkpoint)))
+    {
+        db.rollback();
+        return -1;
+    }
+
+    if (!db.commit())
+    {
+        this->fail("unable to commit", db.lastError().text());
+        return -1;
+    }
+
+    return added;
+}
+
+bool EventIndexDatabase::deleteEvent(const QString &eventId)
+{
+    QSqlQuery query(this->database());
+    query.prepare("DELETE FROM events WHERE event_id = ?");
+    query.addBindValue(eventId);
+    if (!query.exec())
+    {
+        return this->fail("unable to delete event", query.lastError().text());
+    }
+    return query.numRowsAffected() > 0;
+}
+
+bool EventIndexDatabase::isEmpty()
+{
+    QSqlQuery query(this->database());
+    return !(query.exec("SELECT 1 FROM events LIMIT 1") && query.next());
+}
+
+bool EventIndexDatabase::isRoomIndexed(const QString &roomId)
+{
+    QSqlQuery query(this->database());
+    query.prepare("SELECT 1 FROM events WHERE room_id = ? LIMIT 1");
+    query.addBindValue(roomId);
+    return query.exec() && query.next();
+}
+
+const QVariantMap EventIndexDatabase::search(const QVariantMap &args)
+{
+    QStringList highlights;
+    const auto match = EventIndexDatabase::matchExpression(args.value("search_term").toString(), highlights);
+    if (match.isEmpty())
+    {
+        return {
+            {"count", 0},
+            {"results", QVariantList()},
+            {"highlights", QVariantList()},
+        };
+    }
+
+    const auto limit = std::clamp(args.value("limit", 10).toInt(), 1, maxSearchLimit);
+    const auto before = std::clamp(args.value("before_limit").toInt(), 0, maxContextLimit);
+    const auto after = std::clamp(args.value("after_limit").toInt(), 0, maxContextLimit);
+    const auto offset = std::max(0, args.value("next_batch").toString().toInt());
+    const auto roomId = args.value("room_id").toString();
+
+    const auto from = QString("FROM events_fts JOIN events e ON e.id = events_fts.rowid WHERE events_fts MATCH :match%1")
+        .arg(roomId.isEmpty() ? "" : " AND e.room_id = :room");
+
+    QSqlQuery count(this->database());
+    count.prepare("SELECT count(*) " + from);
+    count.bindValue(":match", match);
+    if (!roomId.isEmpty())
+    {
+        count.bindValue(":room", roomId);
+    }
+    if (!count.exec() || !count.next())
+    {
+        this->fail("unable to search", count.lastError().text());
+        return {};
+    }
+    const auto total = count.value(0).toInt();
+
+    QSqlQuery query(this->database());
+    query.prepare(QString("SELECT e.room_id, e.server_ts, e.source, e.sender, e.profile, bm25(events_fts) %1 ORDER BY %2 LIMIT :limit OFFSET :offset")
+        .arg(from, args.value("order_by_recency").toBool() ? "e.server_ts DESC" : "bm25(events_fts)"));
+    query.bindValue(":match", match);
+    if (!roomId.isEmpty())
+    {
+        query.bindValue(":room", roomId);
+    }
+    query.bindValue(":limit", limit);
+    query.bindValue(":offset", offset);
+    if (!query.exec())
+    {
+        this->fail("unable to search", query.lastError().text());
+        return {};
+    }
+
+    QVariantList results;
+    while (query.next())
+    {
+        QVariantMap profiles{
+            {query.value(3).toString(), fromJson(query.value(4))},
+        };
+        auto context = this->context(query.value(0).toString(), query.value(1).toLongLong(), before, after, profiles);
+        context.insert("profile_info", profiles);
+
+        // bm25 is lower for better matches
+        results.append(QVariantMap{
+            {"rank", -query.value(5).toDouble()},
+            {"result", fromJson(query.value(2))},
+            {"context", context},
+        });
+    }
+
+    QVariantMap response{
+        {"count", total},
+        {"results", results},
+        {"highlights", highlights},
+    };
+    if (offset + results.size() < total && !results.isEmpty())
+    {
+        response.insert("next_batch", QString::number(offset + results.size()));
+    }
+    return response;
+}
+
+const QVariantList EventIndexDatabase::loadFileEvents(const QVariantMap &args)
+{
+    const auto roomId = args.value("roomId").toString();
+    const auto limit = std::clamp(args.value("limit", 10).toInt(), 1, maxSearchLimit);
+    const auto forward = args.value("direction").toString() == "f";
+
+    qint64 timestamp = forward ? std::numeric_limits<qint64>::min() : std::numeric_limits<qint64>::max();
+    if (args.contains("fromEvent"))
+    {
+        QSqlQuery from(this->database());
+        from.prepare("SELECT server_ts FROM events WHERE event_id = ?");
+        from.addBindValue(args.value("fromEvent").toString());
+        if (from.exec() && from.next())
+        {
+            timestamp = from.value(0).toLongLong();
+        }
+    }
+
+    QSqlQuery query(this->database());
+    query.prepare(QString("SELECT source, profile FROM events WHERE room_id = ? AND has_url = 1 AND server_ts %1 ? ORDER BY server_ts %2 LIMIT ?")
+        .arg(forward ? ">" : "<", forward ? "ASC" : "DESC"));
+    query.addBindValue(roomId);
+    query.addBindValue(timestamp);
+    query.addBindValue(limit);
+    if (!query.exec())
+    {
+        this->fail("unable to load file events", query.lastError().text());
+        return {};
+    }
+
+    QVariantList events;
+    while (query.next())
+    {
+        events.append(QVariantMap{
+            {"event", fromJson(query.value(0))},
+            {"profile", fromJson(query.value(1))},
+        });
+    }
+    return events;
+}
+
+const QVariantList EventIndexDatabase::loadCheckpoints()
+{
+    QSqlQuery query(this->database());
+    if (!query.exec("SELECT room_id, token, full_crawl, direction FROM checkpoints"))
+    {
+        this->fail("unable to load checkpoints", query.lastError().text());
+        return {};
+    }
+
+    QVariantList checkpoints;
+    while (query.next())
+    {
+        checkpoints.append(QVariantMap{
+            {"roomId", query.value(0)},
+            {"token", query.value(1)},
+            {"fullCrawl", query.value(2).toBool()},
+            {"direction", query.value(3)},
+        });
+    }
+    return checkpoints;
+}
+
+bool EventIndexDatabase::addCheckpoint(const QVariantMap &checkpoint)
+{
+    QSqlQuery query(this->database());
+    query.prepare("INSERT OR REPLACE INTO checkpoints (room_id, token, full_crawl, direction) VALUES (?, ?, ?, ?)");
+    query.addBindValue(checkpoint.value("roomId").toString());
+    query.addBindValue(checkpoint.value("token").toString());
+    query.addBindValue(checkpoint.value("fullCrawl").toBool());
+    query.addBindValue(checkpoint.value("direction").toString());
+    if (!query.exec())
+    {
+        return this->fail("unable to add checkpoint", query.lastError().text());
+    }
+    return true;
+}
+
+bool EventIndexDatabase::removeCheckpoint(const QVariantMap &checkpoint)
+{
+    QSqlQuery query(this->database());
+    query.prepare("DELETE FROM checkpoints WHERE room_id = ? AND token = ? AND direction = ?");
+    query.addBindValue(checkpoint.value("roomId").toString());
+    query.addBindValue(checkpoint.value("token").toString());
+    query.addBindValue(checkpoint.value("direction").toString());
+    if (!query.exec())
+    {
+        return this->fail("unable to remove checkpoint", query.lastError().text());
+    }
+    return true;
+}
+
+int EventIndexDatabase::userVersion()
+{
+    QSqlQuery query(this->database());
+    if (query.exec("SELECT value FROM meta WHERE key = 'userVersion'") && query.next())
+    {
+        return query.value(0).toInt();
+    }
+    return 0;
+}
+
+bool EventIndexDatabase::setUserVersion(int version)
+{
+    QSqlQuery query(this->database());
+    query.prepare("INSERT OR REPLACE INTO meta (key, value) VALUES ('userVersion', ?)");
+    query.addBindValue(version);
+    if (!query.exec())
+    {
+        return this->fail("unable to set user version", query.lastError().text());
+    }
+    return true;
+}
+
+const QVariantMap EventIndexDatabase::stats()
+{
+    qint64 size = 0;
+    QDirIterator it(this->directory, QDir::Files);
+    while (it.hasNext())
+    {
+        it.next();
+        size += it.fileInfo().size();
+    }
+
+    QSqlQuery query(this->database());
+    const auto count = [&query](const QString &statement) {
+        return query.exec(statement) && query.next() ? query.value(0).toLongLong() : 0;
+    };
+
+    return {
+        {"size", size},
+        {"eventCount", count("SELECT count(*) FROM events")},
+        {"roomCount", count("SELECT count(DISTINCT room_id) FROM events")},
+    };
+}
+
+QSqlDatabase EventIndexDatabase::database() const
+{
+    return QSqlDatabase::database(this->connectionName, false);
+}
+
+bool EventIndexDatabase::exec(const QString &statement)
+{
+    QSqlQuery query(this->database());
+    if (!query.exec(statement))
+    {
+        return this->fail("unable to execute " + statement, query.lastError().text());
+    }
+    return true;
+}
+
+const QVariantMap EventIndexDatabase::context(const QString &roomId, qint64 timestamp, int before, int after, QVariantMap &profiles)
+{
+    const auto load = [&](int limit, bool forward) {
+        QVariantList events;
+        if (limit == 0)
+        {
+            return events;
+        }
+
+        QSqlQuery query(this->database());
+        query.prepare(QString("SELECT source, sender, profile FROM events WHERE room_id = ? AND server_ts %1 ? ORDER BY server_ts %2 LIMIT ?")
+            .arg(forward ? ">" : "<", forward ? "ASC" : "DESC"));
+        query.addBindValue(roomId);
+        query.addBindValue(timestamp);
+        query.addBindValue(limit);
+        query.exec();
+
+        while (query.next())
+        {
+            events.append(fromJson(query.value(0)));
+            profiles.insert(query.value(1).toString(), fromJson(query.value(2)));
+        }
+        return events;
+    };
+
+    // like the /search endpoint, events_before starts with the closest event
+    return {
+        {"events_before", load(before, false)},
+        {"events_after", load(after, true)},
+    };
+}
+
+bool EventIndexDatabase::fail(const QString &what, const QString &error)
+{
+    this->_lastError = QString("%1: %2").arg(what, error);
+    qWarning() << "event index:" << this->_lastError;
+    return false;
+}
+
+const QString EventIndexDatabase::matchExpression(const QString &term, QStringList &highlights)
+{
+    // every word must match, words are quoted to disable the FTS5 query syntax
+    static const QRegularExpression separator("[^\\w]+", QRegularExpression::UseUnicodePropertiesOption);
+    highlights = term.split(separator, Qt::SkipEmptyParts);
+
+    QStringList words;
+    for (auto&& word : highlights)
+    {
+        words.append('"' + word + '"');
+    }
+    return words.join(' ');
+}
+
+EventIndex::EventIndex(const QString &directory, QObject *parent)
+    : QObject(parent)
+{
+    this->database = std::make_unique<EventIndexDatabase>(directory);
+
+    // requests are executed in the order they arrive on a single thread
+    this->worker = std::make_unique<QObject>();
+    this->worker->moveToThread(&this->thread);
+    this->thread.setObjectName("EventIndex");
+    this->thread.start(QThread::LowPriority);
+}
+
+EventIndex::~EventIndex()
+{
+    QMetaObject::invokeMethod(this->worker.get(), [this]{
+        this->flush();
+        this->database.reset();
+    }, Qt::BlockingQueuedConnection);
+
+    this->thread.quit();
+    this->thread.wait();
+}
+
+int EventIndex::request(const QString &method, const QVariantList &args)
+{
+    const auto requestId = this->nextRequestId++;
+
+    QMetaObject::invokeMethod(this->worker.get(), [this, requestId, method, args]{
+        QString error;
+        const auto result = this->handle(method, args, error);
+
+        // the web channel lives on the main thread
+        QMetaObject::invokeMethod(this, [this, requestId, result, error]{
+            emit replied(requestId, result, error);
+        }, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
+
+    return requestId;
+}
+
+const QVariant EventIndex::handle(const QString &method, const QVariantList &args, QString &error)
+{
+    if (method == "addEventToIndex")
+    {
+        this->addLiveEvent(QVariantMap{
+            {"event", args.value(0)},
+            {"profile", args.value(1)},
+        });
+        return {};
+    }
+
+    // everything else sees the pending live events
+    this->flush();
+
+    if (method == "closeEventIndex")
+    {
+        this->database->close();
+        return {};
+    }
+    else if (method == "deleteEventIndex")
+    {
+        this->database->remove();
+        return {};
+    }
+
+    this->database->clearError();
+    if (!this->database->open())
+    {
+        // element-web only asks this before initializing the index
+        if (method == "supportsEventIndexing")
+        {
+            return false;
+        }
+
+        error = this->database->lastError();
+        return {};
+    }
+
+    const auto result = [&]() -> QVariant {
+        if (method == "supportsEventIndexing")
+        {
+            return true;
+        }
+        else if (method == "initEventIndex" || method == "commitLiveEvents")
+        {
+            return {};
+        }
+        else if (method == "deleteEvent")
+        {
+            return this->database->deleteEvent(args.value(0).toString());
+        }
+        else if (method == "isEventIndexEmpty")
+        {
+            return this->database->isEmpty();
+        }
+        else if (method == "isRoomIndexed")
+        {
+            return this->database->isRoomIndexed(args.value(0).toString());
+        }
+        else if (method == "searchEventIndex")
+        {
+            return this->database->search(args.value(0).toMap());
+        }
+        else if (method == "addHistoricEvents")
+        {
+            // the crawler stops when a batch was indexed before
+            const auto events = args.value(0).toList();
+            const auto added = this->database->addEvents(events, args.value(1).toMap(), args.value(2).toMap());
+            return added < 0 ? QVariant() : QVariant(!events.isEmpty() && added == 0);
+        }
+        else if (method == "addCrawlerCheckpoint")
+        {
+            return this->database->addCheckpoint(args.value(0).toMap());
+        }
+        else if (method == "removeCrawlerCheckpoint")
+        {
+            return this->database->removeCheckpoint(args.value(0).toMap());
+        }
+        else if (method == "loadFileEvents")
+        {
+            return this->database->loadFileEvents(args.value(0).toMap());
+        }
+        else if (method == "loadCheckpoints")
+        {
+            return this->database->loadCheckpoints();
+        }
+        else if (method == "setUserVersion")
+        {
+            return this->database->setUserVersion(args.value(0).toInt());
+        }
+        else if (method == "getUserVersion")
+        {
+            return this->database->userVersion();
+        }
+        else if (method == "getStats")
+        {
+            return this->database->stats();
+        }
+
+        error = "unknown method " + method;
+        return {};
+    }();
+
+    if (error.isEmpty())
+    {
+        error = this->database->lastError();
+    }
+
+    return result;
+}
+
+void EventIndex::addLiveEvent(const QVariantMap &event)
+{
+    this->pending.append(event);
+
+    if (this->pending.size() >= liveBatchSize)
+    {
+        this->flush();
+    }
+    else if (!this->flushScheduled)
+    {
+        this->flushScheduled = true;
+        QTimer::singleShot(liveFlushDelay, this->worker.get(), [this]{
+            this->flush();
+        });
+    }
+}
+
+void EventIndex::flush()
+{
+    this->flushScheduled = false;
+    if (this->pending.isEmpty() || !this->database || !this->database->open())
+    {
+        return;
+    }
+
+    if (this->database->addEvents(this->pending) < 0)
+    {
+        qWarning() << "event index: dropped" << this->pending.size() << "live events";
+    }
+    this->pending.clear();
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVariant>
+#include <QThread>
+#include <QSqlDatabase>
+
+#include <memory>
+
+/**
+ * Full-text index of decrypted Matrix events in a SQLite FTS5 database.
+ *
+ * All methods must be called from the thread which opened the database.
+ * Events are {event, profile} objects with the raw Matrix event and the
+ * profile of the sender, the same format element-web uses for Seshat.
+ */
+class EventIndexDatabase
+{
+public:
+    explicit EventIndexDatabase(const QString &directory);
+    ~EventIndexDatabase();
+
+    bool open();
+    void close();
+    bool isOpen() const;
+
+    // closes the database and deletes the directory
+    bool remove();
+
+    // error of the last failed operation, kept until cleared
+    const QString &lastError() const;
+    void clearError();
+
+    /**
+     * Writes the events in a single transaction, events which are already
+     * indexed are skipped. The crawler checkpoint is replaced by the new
+     * checkpoint in the same transaction. Returns the number of new events
+     * or -1 on errors.
+     */
+    int addEvents(const QVariantList &events, const QVariantMap &checkpoint = {}, const QVariantMap &oldCheckpoint = {});
+
+    bool deleteEvent(const QString &eventId);
+    bool isEmpty();
+    bool isRoomIndexed(const QString &roomId);
+
+    /**
+     * Takes the SearchArgs of element-web and returns an IResultRoomEvents
+     * object, like the /search endpoint of the homeserver.
+     */
+    const QVariantMap search(const QVariantMap &args);
+
+    const QVariantList loadFileEvents(const QVariantMap &args);
+
+    const QVariantList loadCheckpoints();
+    bool addCheckpoint(const QVariantMap &checkpoint);
+    bool removeCheckpoint(const QVariantMap &checkpoint);
+
+    int userVersion();
+    bool setUserVersion(int version);
+
+    // {size, eventCount, roomCount}
+    const QVariantMap stats();
+
+private:
+    QSqlDatabase database() const;
+    bool exec(const QString &statement);
+    const QVariantMap context(const QString &roomId, qint64 timestamp, int before, int after, QVariantMap &profiles);
+    bool fail(const QString &what, const QString &error);
+
+    static const QString matchExpression(const QString &term, QStringList &highlights);
+
+    QString directory;
+    QString connectionName;
+    QString _lastError;
+};
+
+/**
+ * Event index of a profile, exposed to element-web over QWebChannel as
+ * the event indexing manager of the platform (see assets/scripts/event-index.js).
+ *
+ * Requests are executed in order on a background thread and answered with
+ * the replied signal. Live events are collected and written in batches,
+ * historic events of the crawler are written together with their checkpoint,
+ * so an interrupted crawl resumes from the last written batch.
+ */
+class EventIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EventIndex(const QString &directory, QObject *parent = nullptr);
+    ~EventIndex();
+
+    static const QString channelName()
+    {
+        return "qelementEventIndex";
+    }
+
+    /**
+     * Queues a call of a BaseEventIndexManager method and returns the id
+     * of the request.
+     */
+    Q_INVOKABLE int request(const QString &method, const QVariantList &args);
+
+signals:
+    /**
+     * error is empty when the request succeeded.
+     */
+    void replied(int requestId, const QVariant &result, const QString &error);
+
+private:
+    const QVariant handle(const QString &method, const QVariantList &args, QString &error);
+    void addLiveEvent(const QVariantMap &event);
+    void flush();
+
+    // only used on the worker thread
+    std::unique_ptr<EventIndexDatabase> database;
+    QVariantList pending;
+    bool flushScheduled = false;
+
+    int nextRequestId = 1;
+    QThread thread;
+    std::unique_ptr<QObject> worker;
+};
@@ -0,0 +1,178 @@
+#include "externallinkstress.hpp"
+#include "webenginepage.hpp"
+
+#include <QWebEngineProfile>
+#include <QWebEngineSettings>
+#include <QCoreApplication>
+#include <QFile>
+#include <QDir>
+#include <QTimer>
+#include <QDebug>
+
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+// links opened by one script execution
+constexpr const int batchSize = 100;
+
+// give up when a batch isn't opened in time
+constexpr const int batchTimeout = 10000;
+
+// memory after this share of the links is the baseline, the caches are warm then
+constexpr const double baselineShare = 0.1;
+
+// allowed growth from the baseline to the end
+constexpr const qint64 allowedGrowth = 20 * 1024 * 1024;
+constexpr const double allowedGrowthShare = 0.1;
+
+// %1 is the first and %2 the end of the range of links
+static const char *batchScript = R"(
+for (let i = %1; i < %2; ++i) {
+    const url = "https://example.com/external-link-stress/" + i;
+    if (i % 10 === 9) {
+        const w = window.open("", "_blank");
+        if (w) {
+            w.location.href = url;
+        }
+    } else {
+        window.open(url, "_blank", "noopener,noreferrer");
+    }
+}
+)";
+
+ExternalLinkStress::ExternalLinkStress(int links, QObject *parent)
+    : QObject(parent)
+{
+    this->links = links;
+
+    this->timeout = std::make_unique<QTimer>();
+    this->timeout->setSingleShot(true);
+    this->timeout->setInterval(batchTimeout);
+    connect(this->timeout.get(), &QTimer::timeout, this, [this]{
+        qWarning() << "external link stress: only" << this->opened << "of" << this->requested << "links were opened";
+        this->finish(false);
+    });
+}
+
+ExternalLinkStress::~ExternalLinkStress()
+{
+    this->timeout->stop();
+}
+
+void ExternalLinkStress::start()
+{
+    // off-the-record profiles keep everything in memory and start empty
+    this->profile = std::make_unique<QWebEngineProfile>();
+    this->page = std::make_unique<WebEnginePage>(this->profile.get());
+    this->page->settings()->setAttribute(QWebEngineSettings::JavascriptCanOpenWindows, true);
+    this->page->setOpenExternalLinks(false);
+    connect(this->page.get(), &WebEnginePage::externalLinkRequested, this, &ExternalLinkStress::linkOpened);
+
+    connect(this->page.get(), &QWebEnginePage::loadFinished, this, [this](bool ok) {
+        if (!ok)
+        {
+            qWarning() << "external link stress: failed to load the page";
+            this->finish(false);
+            return;
+        }
+        this->nextBatch();
+    }, Qt::SingleShotConnection);
+
+    this->page->setHtml("<!DOCTYPE html><html><head></head><body></body></html>", QUrl("https://localhost/"));
+}
+
+const QJsonObject ExternalLinkStress::report() const
+{
+    return {
+        {"links", this->links},
+        {"opened", this->opened},
+        {"baselineRss", this->baselineRss},
+        {"finalRss", this->finalRss},
+        {"growth", this->baselineRss >= 0 && this->finalRss >= 0 ? this->finalRss - this->baselineRss : -1},
+        {"stable", this->stable},
+        {"samples", this->samples},
+    };
+}
+
+void ExternalLinkStress::nextBatch()
+{
+    const auto rss = ExternalLinkStress::processTreeRss(QCoreApplication::applicationPid());
+    this->samples.append(QJsonObject{{"opened", this->opened}, {"rss", rss}});
+    if (this->baselineRss < 0 && this->opened >= int(this->links * baselineShare))
+    {
+        this->baselineRss = rss;
+    }
+
+    if (this->requested >= this->links)
+    {
+        // let the discarded windows be cleaned up before the final measurement
+        QTimer::singleShot(1000, this, [this]{
+            this->finalRss = ExternalLinkStress::processTreeRss(QCoreApplication::applicationPid());
+            const auto limit = std::max(allowedGrowth, qint64(double(this->baselineRss) * allowedGrowthShare));
+            this->stable = this->baselineRss >= 0 && this->finalRss >= 0 && this->finalRss - this->baselineRss <= limit;
+            this->finish(this->stable && this->opened == this->links);
+        });
+        return;
+    }
+
+    const auto from = this->requested;
+    this->requested = std::min(this->links, from + batchSize);
+    this->timeout->start();
+    this->page->runJavaScript(QString(batchScript).arg(from).arg(this->requested));
+}
+
+void ExternalLinkStress::linkOpened()
+{
+    ++this->opened;
+    if (this->opened >= this->requested && this->timeout->isActive())
+    {
+        this->timeout->stop();
+        QTimer::singleShot(0, this, &ExternalLinkStress::nextBatch);
+    }
+}
+
+void ExternalLinkStress::finish(bool success)
+{
+    this->timeout->stop();
+
+    // the page must be deleted before its profile
+    this->page.reset();
+    emit finished(success);
+}
+
+qint64 ExternalLinkStress::processTreeRss(qint64 pid)
+{
+#ifdef Q_OS_LINUX
+    // resident pages of the process and recursively of its children, like the zygote and the renderers
+    QFile statm(QString("/proc/%1/statm").arg(pid));
+    if (!statm.open(QIODevice::ReadOnly))
+    {
+        return 0;
+    }
+    auto rss = statm.readAll().split(' ').value(1).toLongLong() * sysconf(_SC_PAGESIZE);
+
+    const auto tasks = QDir(QString("/proc/%1/task").arg(pid)).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (auto&& task : tasks)
+    {
+        QFile children(QString("/proc/%1/task/%2/children").arg(pid).arg(task));
+        if (!children.open(QIODevice::ReadOnly))
+        {
+            continue;
+        }
+        for (auto&& child : children.readAll().split(' '))
+        {
+            if (!child.trimmed().isEmpty())
+            {
+                rss += ExternalLinkStress::processTreeRss(child.trimmed().toLongLong());
+            }
+        }
+    }
+    return rss;
+#else
+    Q_UNUSED(pid);
+    return -1;
+#endif
+}
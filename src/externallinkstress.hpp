@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QObject>
+#include <QJsonArray>
+#include <QJsonObject>
+
+#include <memory>
+
+class QWebEngineProfile;
+class QTimer;
+class WebEnginePage;
+
+/**
+ * Opens many external links from a page offscreen and checks that the
+ * memory of the browser and its renderer processes stays stable.
+ *
+ * Most links are opened with window.open(url), every tenth with an empty
+ * window which is navigated afterwards. The system web browser isn't
+ * started, the links are only counted. Memory is in bytes.
+ */
+class ExternalLinkStress : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ExternalLinkStress(int links, QObject *parent = nullptr);
+    ~ExternalLinkStress();
+
+    void start();
+
+    const QJsonObject report() const;
+
+signals:
+    void finished(bool success);
+
+private:
+    void nextBatch();
+    void linkOpened();
+    void finish(bool success);
+
+    static qint64 processTreeRss(qint64 pid);
+
+    int links;
+    int requested = 0;
+    int opened = 0;
+    qint64 baselineRss = -1;
+    qint64 finalRss = -1;
+    QJsonArray samples;
+    bool stable = false;
+
+    std::unique_ptr<QWebEngineProfile> profile;
+    std::unique_ptr<WebEnginePage> page;
+    std::unique_ptr<QTimer> timeout;
+};
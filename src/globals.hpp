@@ -3,5 +3,8 @@
 #include "paths.hpp"
 #include "configmanager.hpp"
 
+class StallWatchdog;
+
 extern const Paths *paths;
 extern ConfigManager *config;
+extern StallWatchdog *watchdog; // nullptr when disabled
@@ -0,0 +1,218 @@
+#include "httpcache.hpp"
+#include "globals.hpp"
+#include "configmanager.hpp"
+
+#include <QCoreApplication>
+#include <QWebEngineProfile>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDir>
+#include <QDebug>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+// tmpfs lives in memory, never leave the size of the cache unbounded
+constexpr const qint64 defaultTmpfsCacheSize = 256 * 1024 * 1024;
+
+namespace
+{
+    struct WriteBack
+    {
+        QString source;
+        QString destination;
+        qint64 size;
+    };
+
+    // QtWebEngine flushes the cache asynchronously until it is shut down together
+    // with the QApplication, the caches are only copied on exit after that
+    std::vector<WriteBack> pendingWriteBacks;
+}
+
+HttpCache::HttpCache(const QString &profileName, const ConfigManager *config)
+{
+    bool ok = false;
+    this->_type = HttpCache::parseType(config->cacheType(), &ok);
+    if (!ok)
+    {
+        qWarning() << "cache: unknown type" << config->cacheType() << "- using disk";
+    }
+
+    const auto profilePath = paths->webEngineProfilePath(profileName);
+
+    if (this->_type == Type::Tmpfs)
+    {
+        const auto runtimeDir = qEnvironmentVariable("XDG_RUNTIME_DIR");
+        if (runtimeDir.isEmpty() || !QFileInfo(runtimeDir).isDir())
+        {
+            qWarning() << "cache: $XDG_RUNTIME_DIR is not available - using disk";
+            this->_type = Type::Disk;
+        }
+        else
+        {
+            this->_path = QString("%1/%2/%3").arg(runtimeDir, qApp->applicationName(), QFileInfo(profilePath).fileName());
+            this->hotSetPath = QString("%1/%2").arg(profilePath, "CacheHotSet");
+            this->writeBackSize = config->cacheWriteBack() ? qint64(std::max(0, config->cacheWriteBackSize())) * 1024 * 1024 : 0;
+            this->restore();
+        }
+    }
+
+    if (this->_type == Type::Disk)
+    {
+        this->_path = config->cacheLocation().isEmpty() ? profilePath :
+            QString("%1/%2").arg(config->cacheLocation(), QFileInfo(profilePath).fileName());
+    }
+
+    if (!this->_path.isEmpty())
+    {
+        QDir(this->_path).mkpath(".");
+    }
+}
+
+HttpCache::~HttpCache()
+{
+    if (this->_type != Type::Tmpfs || this->writeBackSize <= 0)
+    {
+        return;
+    }
+
+    if (pendingWriteBacks.empty())
+    {
+        std::atexit(HttpCache::writeBack);
+    }
+    pendingWriteBacks.push_back({this->_path, this->hotSetPath, this->writeBackSize});
+}
+
+HttpCache::Type HttpCache::parseType(const QString &type, bool *ok)
+{
+    if (ok)
+    {
+        *ok = true;
+    }
+
+    if (type == "memory")
+    {
+        return Type::Memory;
+    }
+    else if (type == "none")
+    {
+        return Type::None;
+    }
+    else if (type == "tmpfs")
+    {
+        return Type::Tmpfs;
+    }
+    else if (type != "disk" && ok)
+    {
+        *ok = false;
+    }
+
+    return Type::Disk;
+}
+
+HttpCache::Type HttpCache::type() const
+{
+    return this->_type;
+}
+
+const QString &HttpCache::path() const
+{
+    return this->_path;
+}
+
+void HttpCache::apply(QWebEngineProfile *profile, qint64 maxSize) const
+{
+    switch (this->_type)
+    {
+        case Type::Memory:
+            profile->setHttpCacheType(QWebEngineProfile::MemoryHttpCache);
+            break;
+
+        case Type::None:
+            profile->setHttpCacheType(QWebEngineProfile::NoCache);
+            return;
+
+        case Type::Disk:
+        case Type::Tmpfs:
+            profile->setHttpCacheType(QWebEngineProfile::DiskHttpCache);
+            profile->setCachePath(this->_path);
+            break;
+    }
+
+    if (this->_type == Type::Tmpfs && maxSize <= 0)
+    {
+        maxSize = defaultTmpfsCacheSize;
+    }
+
+    if (maxSize > 0)
+    {
+        profile->setHttpCacheMaximumSize(maxSize);
+    }
+}
+
+void HttpCache::restore() const
+{
+    // the tmpfs survives restarts of the application, only restore after a reboot
+    if (!QDir(this->_path).isEmpty() || !QFileInfo(this->hotSetPath).isDir())
+    {
+        return;
+    }
+
+    const auto bytes = HttpCache::copyFiles(this->hotSetPath, this->_path, -1);
+    qDebug() << "cache: restored" << bytes << "bytes to" << this->_path;
+}
+
+void HttpCache::writeBack()
+{
+    for (auto&& writeBack : pendingWriteBacks)
+    {
+        QDir(writeBack.destination).removeRecursively();
+        const auto bytes = HttpCache::copyFiles(writeBack.source, writeBack.destination, writeBack.size);
+        qDebug() << "cache: wrote back" << bytes << "bytes to" << writeBack.destination;
+    }
+    pendingWriteBacks.clear();
+}
+
+qint64 HttpCache::copyFiles(const QString &source, const QString &destination, qint64 budget)
+{
+    std::vector<QFileInfo> files;
+    QDirIterator it(source, QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        it.next();
+        files.emplace_back(it.fileInfo());
+    }
+
+    // the cache index comes first, then the most recently used entries,
+    // entries missing from the index are simply cache misses for Chromium
+    std::sort(files.begin(), files.end(), [](const QFileInfo &a, const QFileInfo &b){
+        const bool aIndex = a.fileName().contains("index");
+        const bool bIndex = b.fileName().contains("index");
+        if (aIndex != bIndex)
+        {
+            return aIndex;
+        }
+        return a.lastModified() > b.lastModified();
+    });
+
+    const QDir sourceDir(source);
+    qint64 copied = 0;
+    for (auto&& file : files)
+    {
+        if (budget >= 0 && copied + file.size() > budget)
+        {
+            continue;
+        }
+
+        const auto target = QString("%1/%2").arg(destination, sourceDir.relativeFilePath(file.filePath()));
+        QDir().mkpath(QFileInfo(target).path());
+        if (QFile::copy(file.filePath(), target))
+        {
+            copied += file.size();
+        }
+    }
+
+    return copied;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QString>
+
+class QWebEngineProfile;
+class ConfigManager;
+
+/**
+ * Placement of the Chromium HTTP cache of a profile, see the [cache]
+ * section of the preferences.
+ *
+ *  - disk:   on disk in the profile directory or in cache/location
+ *  - memory: in memory only, nothing is written to disk
+ *  - none:   no HTTP cache at all
+ *  - tmpfs:  on disk in $XDG_RUNTIME_DIR, which is a tmpfs on most systems.
+ *            With cache/writeBack the most recently used entries are copied
+ *            to the profile directory on exit and restored after a reboot.
+ */
+class HttpCache
+{
+public:
+    enum class Type
+    {
+        Disk,
+        Memory,
+        None,
+        Tmpfs,
+    };
+
+    HttpCache(const QString &profileName, const ConfigManager *config);
+
+    /**
+     * Schedules the write back of the hot set of a tmpfs cache. It runs on
+     * exit after the QApplication is destroyed, when QtWebEngine has shut
+     * down and written the cache index and all entries.
+     */
+    ~HttpCache();
+
+    /**
+     * Parses a cache/type value, unknown types return the disk cache.
+     */
+    static Type parseType(const QString &type, bool *ok = nullptr);
+
+    Type type() const;
+
+    /**
+     * Directory of the disk cache, empty for the memory cache and no cache.
+     */
+    const QString &path() const;
+
+    /**
+     * Applies the cache type and location to the profile.
+     * A maxSize of 0 leaves the QtWebEngine default.
+     */
+    void apply(QWebEngineProfile *profile, qint64 maxSize) const;
+
+private:
+    void restore() const;
+    static void writeBack();
+
+    static qint64 copyFiles(const QString &source, const QString &destination, qint64 budget);
+
+    Type _type = Type::Disk;
+    QString _path;
+    QString hotSetPath;
+    qint64 writeBackSize = 0;
+};
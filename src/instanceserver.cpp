@@ -0,0 +1,138 @@
+#include "instanceserver.hpp"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QDir>
+#include <QUrl>
+#include <QDebug>
+
+#ifdef Q_OS_UNIX
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+#endif
+
+// limit the amount of data a client can send
+constexpr const qint64 maxMessageSize = 64 * 1024;
+
+InstanceServer::InstanceServer(const QString &profile, QObject *parent)
+    : QObject(parent)
+{
+    this->profile = profile;
+    this->server = std::make_unique<QLocalServer>();
+    this->server->setSocketOptions(QLocalServer::UserAccessOption);
+    connect(this->server.get(), &QLocalServer::newConnection, this, &InstanceServer::newConnection);
+}
+
+InstanceServer::~InstanceServer()
+{
+    this->server->close();
+}
+
+bool InstanceServer::listen()
+{
+    const auto path = InstanceServer::socketPath(this->profile);
+
+    // remove stale socket of a crashed instance, safe while holding the instance lock
+    QLocalServer::removeServer(path);
+
+    if (!this->server->listen(path))
+    {
+        qWarning() << "unable to listen on" << path << this->server->errorString();
+        return false;
+    }
+
+    return true;
+}
+
+const QString InstanceServer::socketPath(const QString &profile)
+{
+    return QString("%1/%2").arg(QDir::tempPath(), "qelement-instance-" + profile + ".sock");
+}
+
+bool InstanceServer::forward(const QString &profile, const QStringList &commands)
+{
+#ifdef Q_OS_UNIX
+    // plain sockets, QLocalSocket requires an event dispatcher and therefore QCoreApplication
+    const auto path = InstanceServer::socketPath(profile).toLocal8Bit();
+    const auto message = commands.join('\n').toUtf8() + '\n';
+
+    sockaddr_un address{};
+    if (std::size_t(path.size()) >= sizeof(address.sun_path))
+    {
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.constData(), path.size());
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    bool success = ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+
+    qint64 written = 0;
+    while (success && written < message.size())
+    {
+        const auto res = ::write(fd, message.constData() + written, std::size_t(message.size() - written));
+        if (res < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        success = res > 0;
+        written += res;
+    }
+
+    ::close(fd);
+    return success;
+#else
+    return false;
+#endif
+}
+
+void InstanceServer::newConnection()
+{
+    while (auto socket = this->server->nextPendingConnection())
+    {
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]{
+            if (socket->bytesAvailable() > maxMessageSize)
+            {
+                qWarning() << "instance server: dropping oversized message";
+                socket->abort();
+            }
+        });
+
+        // the client closes the connection after writing all commands
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]{
+            this->readCommands(socket);
+        });
+    }
+}
+
+void InstanceServer::readCommands(QLocalSocket *socket)
+{
+    const auto commands = QString::fromUtf8(socket->readAll()).split('\n', Qt::SkipEmptyParts);
+
+    for (auto&& command : commands)
+    {
+        qDebug() << "instance server: received command" << command;
+
+        if (command == "show")
+        {
+            emit showRequested();
+        }
+        else if (command.startsWith("open="))
+        {
+            const QUrl url(command.mid(5));
+            if (url.isValid())
+            {
+                emit openRequested(url);
+            }
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QObject>
+#include <QStringList>
+
+#include <memory>
+
+class QLocalServer;
+class QLocalSocket;
+
+/**
+ * Per-profile local socket owned by the process holding the instance lock.
+ * Subsequent launches forward their commands over the socket and exit
+ * immediately, before QApplication or QtWebEngine are initialized.
+ *
+ * The protocol consists of UTF-8 encoded commands, one per line:
+ *   show         raise the window
+ *   open=<url>   open a matrix.to or element:// url
+ */
+class InstanceServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit InstanceServer(const QString &profile, QObject *parent = nullptr);
+    ~InstanceServer();
+
+    /**
+     * Starts listening, must only be called while holding the instance lock.
+     */
+    bool listen();
+
+    /**
+     * Sends the commands to the running instance of the given profile.
+     * Doesn't require a QCoreApplication instance.
+     */
+    static bool forward(const QString &profile, const QStringList &commands);
+
+    static const QString socketPath(const QString &profile);
+
+signals:
+    void showRequested();
+    void openRequested(const QUrl &url);
+
+private:
+    void newConnection();
+    void readCommands(QLocalSocket *socket);
+
+    QString profile;
+    std::unique_ptr<QLocalServer> server;
+};
@@ -0,0 +1,478 @@
+#include "log.hpp"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QStringEncoder>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifdef JOURNAL_ENABLED
+#include <systemd/sd-journal.h>
+#endif
+
+namespace
+{
+    // 2 MiB of messages, longer messages are truncated
+    constexpr const std::uint64_t slotCount = 4096;
+    constexpr const std::size_t textSize = 480;
+
+    struct alignas(64) Slot
+    {
+        // the slot is free for the producer at position p when the sequence
+        // is p and filled for the consumer when it is p + 1
+        std::atomic<std::uint64_t> sequence;
+        QtMsgType type;
+        bool truncated;
+        std::uint32_t length;
+        std::int64_t timestamp;
+        char text[textSize];
+    };
+
+    // bounded multi producer, single consumer queue
+    std::unique_ptr<Slot[]> slots;
+    alignas(64) std::atomic<std::uint64_t> enqueuePosition{0};
+    alignas(64) std::uint64_t dequeuePosition = 0;
+    std::atomic<std::uint64_t> writtenPosition{0};
+    std::atomic<std::uint64_t> droppedCount{0};
+
+    // the drain thread sleeps on wakeups while the queue is empty
+    std::atomic<std::uint32_t> wakeups{0};
+    std::atomic<bool> sleeping{false};
+    std::atomic<bool> running{false};
+    std::thread drainThread;
+    thread_local bool inDrain = false;
+
+    std::atomic<bool> consoleStderr{false};
+
+    // sink state, only used by the drain thread and while switching sinks
+    std::mutex sinkMutex;
+    Log::Sink sink = Log::Sink::Console;
+    std::string filePath;
+    std::FILE *file = nullptr;
+    std::int64_t fileSize = 0;
+    std::int64_t maxFileSize = 0;
+    int maxFiles = 0;
+    std::uint64_t reportedDropped = 0;
+    std::string stdoutBuffer;
+    std::string stderrBuffer;
+    std::string fileBuffer;
+    std::int64_t prefixSecond = -1;
+    std::string prefix;
+
+    inline std::int64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    inline void wake()
+    {
+        wakeups.fetch_add(1);
+        wakeups.notify_one();
+    }
+
+    inline char levelLetter(QtMsgType type)
+    {
+        switch (type)
+        {
+            case QtDebugMsg:    return 'D';
+            case QtInfoMsg:     return 'I';
+            case QtWarningMsg:  return 'W';
+            case QtCriticalMsg: return 'C';
+            case QtFatalMsg:    return 'F';
+        }
+        return '?';
+    }
+
+    std::uint32_t encode(const QString &message, char *text, bool &truncated)
+    {
+        // most messages fit, encoding in place avoids an allocation on the caller
+        truncated = false;
+        if (message.size() * 3 <= qsizetype(textSize))
+        {
+            QStringEncoder encoder(QStringEncoder::Utf8, QStringConverter::Flag::Stateless);
+            return std::uint32_t(encoder.appendToBuffer(text, message) - text);
+        }
+
+        const auto utf8 = message.toUtf8();
+        auto length = std::min(std::size_t(utf8.size()), textSize);
+        truncated = length < std::size_t(utf8.size());
+
+        // don't cut a multi byte sequence
+        while (truncated && length > 0 && (uchar(utf8.at(qsizetype(length))) & 0xC0) == 0x80)
+        {
+            --length;
+        }
+        std::memcpy(text, utf8.constData(), length);
+        return std::uint32_t(length);
+    }
+
+    bool enqueue(QtMsgType type, const QString &message)
+    {
+        auto position = enqueuePosition.load(std::memory_order_relaxed);
+        Slot *slot = nullptr;
+        for (;;)
+        {
+            slot = &slots[position % slotCount];
+            const auto sequence = slot->sequence.load(std::memory_order_acquire);
+            const auto difference = std::int64_t(sequence - position);
+            if (difference == 0)
+            {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (difference < 0)
+            {
+                // full, the slot wasn't consumed a round ago
+                return false;
+            }
+            else
+            {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->type = type;
+        slot->timestamp = now();
+        slot->length = encode(message, slot->text, slot->truncated);
+
+        // sequentially consistent with the sleeping flag, one side always sees the other
+        slot->sequence.store(position + 1);
+        return true;
+    }
+
+    void rotate()
+    {
+        std::fclose(file);
+        file = nullptr;
+
+        // qelement.log -> qelement.log.1 -> ... -> qelement.log.<files - 1>
+        for (auto i = maxFiles - 1; i > 0; --i)
+        {
+            const auto from = i == 1 ? filePath : filePath + "." + std::to_string(i - 1);
+            const auto to = filePath + "." + std::to_string(i);
+            std::remove(to.c_str());
+            std::rename(from.c_str(), to.c_str());
+        }
+        if (maxFiles <= 1)
+        {
+            std::remove(filePath.c_str());
+        }
+
+        file = std::fopen(filePath.c_str(), "a");
+        fileSize = 0;
+    }
+
+    // sinkMutex must be held
+    void append(QtMsgType type, std::int64_t timestamp, const char *text, std::size_t length, bool truncated)
+    {
+        switch (sink)
+        {
+            case Log::Sink::Console:
+            {
+                auto &buffer = type == QtDebugMsg || consoleStderr.load(std::memory_order_relaxed) ? stderrBuffer : stdoutBuffer;
+                buffer.append(text, length);
+                buffer.append(truncated ? "...\n" : "\n");
+                break;
+            }
+
+            case Log::Sink::File:
+            {
+                // the date is formatted once per second
+                const auto second = timestamp / 1000;
+                if (second != prefixSecond)
+                {
+                    prefixSecond = second;
+                    prefix = QDateTime::fromSecsSinceEpoch(second).toString("yyyy-MM-dd HH:mm:ss").toStdString();
+                }
+
+                char milliseconds[8];
+                std::snprintf(milliseconds, sizeof(milliseconds), ".%03d ", int(timestamp % 1000));
+                fileBuffer.append(prefix).append(milliseconds);
+                fileBuffer.push_back(levelLetter(type));
+                fileBuffer.push_back(' ');
+                fileBuffer.append(text, length);
+                fileBuffer.append(truncated ? "...\n" : "\n");
+                break;
+            }
+
+            case Log::Sink::Journal:
+            {
+#ifdef JOURNAL_ENABLED
+                static const int priorities[] = {7, 4, 3, 2, 6};
+                sd_journal_send("MESSAGE=%.*s%s", int(length), text, truncated ? "..." : "",
+                                "PRIORITY=%i", priorities[std::min(int(type), 4)],
+                                "SYSLOG_IDENTIFIER=qelement",
+                                nullptr);
+#endif
+                break;
+            }
+        }
+    }
+
+    // sinkMutex must be held
+    void write()
+    {
+        const auto dropped = droppedCount.load(std::memory_order_relaxed);
+        if (dropped != reportedDropped)
+        {
+            const auto message = "log: dropped " + std::to_string(dropped - reportedDropped) + " messages";
+            reportedDropped = dropped;
+            append(QtWarningMsg, now(), message.data(), message.size(), false);
+        }
+
+        if (!stderrBuffer.empty())
+        {
+            std::fwrite(stderrBuffer.data(), 1, stderrBuffer.size(), stderr);
+            std::fflush(stderr);
+            stderrBuffer.clear();
+        }
+        if (!stdoutBuffer.empty())
+        {
+            std::fwrite(stdoutBuffer.data(), 1, stdoutBuffer.size(), stdout);
+            std::fflush(stdout);
+            stdoutBuffer.clear();
+        }
+        if (!fileBuffer.empty())
+        {
+            if (file)
+            {
+                std::fwrite(fileBuffer.data(), 1, fileBuffer.size(), file);
+                std::fflush(file);
+                fileSize += std::int64_t(fileBuffer.size());
+                if (maxFileSize > 0 && fileSize >= maxFileSize)
+                {
+                    rotate();
+                }
+            }
+            fileBuffer.clear();
+        }
+    }
+
+    // writes the queued messages, returns false when the queue was empty
+    bool drainBatch()
+    {
+        std::lock_guard lock(sinkMutex);
+
+        auto count = 0;
+        for (;;)
+        {
+            auto &slot = slots[dequeuePosition % slotCount];
+            if (slot.sequence.load() != dequeuePosition + 1)
+            {
+                break;
+            }
+
+            append(slot.type, slot.timestamp, slot.text, slot.length, slot.truncated);
+            slot.sequence.store(dequeuePosition + slotCount, std::memory_order_release);
+            ++dequeuePosition;
+
+            // keep the batches small enough to not hold the sink for long
+            if (++count == 1024)
+            {
+                break;
+            }
+        }
+
+        write();
+        writtenPosition.store(dequeuePosition);
+        return count > 0;
+    }
+
+    void drain()
+    {
+        inDrain = true;
+        while (running.load())
+        {
+            const auto wakeup = wakeups.load();
+            if (drainBatch())
+            {
+                continue;
+            }
+
+            // check once more after announcing the sleep, a producer either sees
+            // the flag or its message is found here
+            sleeping.store(true);
+            if (slots[dequeuePosition % slotCount].sequence.load() != dequeuePosition + 1 && running.load())
+            {
+                wakeups.wait(wakeup);
+            }
+            sleeping.store(false);
+        }
+    }
+
+    void writeSynchronously(QtMsgType type, const QString &message)
+    {
+        const auto utf8 = message.toUtf8();
+        if (inDrain)
+        {
+            std::fprintf(stderr, "%s\n", utf8.constData());
+            return;
+        }
+
+        std::lock_guard lock(sinkMutex);
+        append(type, now(), utf8.constData(), std::size_t(utf8.size()), false);
+        write();
+    }
+}
+
+void Log::initialize()
+{
+    slots = std::make_unique<Slot[]>(slotCount);
+    for (std::uint64_t i = 0; i < slotCount; ++i)
+    {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    running.store(true);
+    drainThread = std::thread(drain);
+    qInstallMessageHandler(Log::messageHandler);
+    std::atexit(Log::shutdown);
+}
+
+void Log::setConsoleStderr(bool enabled)
+{
+    consoleStderr.store(enabled);
+}
+
+bool Log::setSink(Sink newSink, const QString &newFile, qint64 maxSize, int files)
+{
+    // messages of the previous sink are written there
+    Log::flush();
+
+    std::lock_guard lock(sinkMutex);
+    if (file)
+    {
+        std::fclose(file);
+        file = nullptr;
+    }
+
+    sink = Sink::Console;
+    switch (newSink)
+    {
+        case Sink::Console:
+            return true;
+
+        case Sink::File:
+        {
+            QDir().mkpath(QFileInfo(newFile).absolutePath());
+            filePath = QFile::encodeName(newFile).toStdString();
+            file = std::fopen(filePath.c_str(), "a");
+            if (!file)
+            {
+                return false;
+            }
+
+            fileSize = QFileInfo(newFile).size();
+            maxFileSize = maxSize;
+            maxFiles = std::max(1, files);
+            prefixSecond = -1;
+            sink = Sink::File;
+            return true;
+        }
+
+        case Sink::Journal:
+#ifdef JOURNAL_ENABLED
+            sink = Sink::Journal;
+            return true;
+#else
+            return false;
+#endif
+    }
+
+    return false;
+}
+
+Log::Sink Log::sinkFromString(const QString &name)
+{
+    if (name == "journal")
+    {
+        return Sink::Journal;
+    }
+    else if (name == "file")
+    {
+        return Sink::File;
+    }
+    return Sink::Console;
+}
+
+void Log::flush()
+{
+    if (!running.load() || inDrain)
+    {
+        return;
+    }
+
+    const auto target = enqueuePosition.load();
+    wake();
+    while (writtenPosition.load() < target && running.load())
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+quint64 Log::dropped()
+{
+    return droppedCount.load();
+}
+
+void Log::shutdown()
+{
+    if (!running.exchange(false))
+    {
+        return;
+    }
+
+    wake();
+    drainThread.join();
+
+    // messages which were queued while the thread stopped
+    while (drainBatch())
+    {
+    }
+
+    std::lock_guard lock(sinkMutex);
+    if (file)
+    {
+        std::fclose(file);
+        file = nullptr;
+    }
+    sink = Sink::Console;
+}
+
+void Log::messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message)
+{
+    Q_UNUSED(context);
+
+    // fatal messages must be written before Qt aborts
+    if (type == QtFatalMsg || !running.load(std::memory_order_relaxed) || inDrain)
+    {
+        Log::flush();
+        writeSynchronously(type, message);
+        return;
+    }
+
+    if (!enqueue(type, message))
+    {
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (sleeping.load())
+    {
+        wake();
+    }
+}
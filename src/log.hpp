@@ -0,0 +1,64 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+/**
+ * Asynchronous Qt message handler.
+ *
+ * Callers copy the message into a lock-free ring buffer and return, a
+ * background thread drains the buffer into the selected sink. Messages
+ * are dropped and counted when the buffer is full, callers never wait.
+ * Fatal messages are written before the process aborts.
+ *
+ * Debug and info messages are removed at compile time with the LOG_LEVEL
+ * build option, qDebug() then costs nothing and its arguments aren't evaluated.
+ */
+namespace Log
+{
+    enum class Sink
+    {
+        Console,
+        Journal,
+        File,
+    };
+
+    /**
+     * Installs the message handler and starts the drain thread, messages
+     * go to the console until another sink is selected. Must be called
+     * at the very beginning of main().
+     */
+    void initialize();
+
+    /**
+     * Writes all messages to stderr, debug messages always go to stderr
+     * and other messages to stdout by default.
+     */
+    void setConsoleStderr(bool enabled);
+
+    /**
+     * Selects the sink. The file sink writes to file and keeps files - 1
+     * rotated files of up to maxSize bytes. Returns false when the sink
+     * isn't available, the console is used then.
+     */
+    bool setSink(Sink sink, const QString &file = {}, qint64 maxSize = 0, int files = 0);
+
+    // console, journal or file
+    Sink sinkFromString(const QString &name);
+
+    /**
+     * Blocks until all messages queued before the call are written.
+     */
+    void flush();
+
+    // messages which were dropped because the buffer was full
+    quint64 dropped();
+
+    /**
+     * Flushes and stops the drain thread, later messages are written
+     * synchronously. Called automatically on exit.
+     */
+    void shutdown();
+
+    void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message);
+}
@@ -0,0 +1,150 @@
+#include "logbenchmark.hpp"
+#include "log.hpp"
+
+#include <QTemporaryDir>
+#include <QFile>
+#include <QElapsedTimer>
+#include <QUrl>
+#include <QDebug>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// threads logging at the same time
+constexpr const int threadCounts[] = {1, 4};
+
+static std::FILE *syncFile = nullptr;
+
+// the handler which was used before the asynchronous logger
+static void syncHandler(QtMsgType type, const QMessageLogContext &context, const QString &message)
+{
+    Q_UNUSED(type);
+    Q_UNUSED(context);
+    std::fprintf(syncFile, "%s\n", message.toStdString().c_str());
+}
+
+static double percentile(std::vector<double> values, double p)
+{
+    if (values.empty())
+    {
+        return -1;
+    }
+
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, std::size_t(p * double(values.size())))];
+}
+
+LogBenchmark::LogBenchmark(const QString &directory, int messages)
+{
+    this->directory = directory;
+    this->messages = messages;
+}
+
+const QJsonObject LogBenchmark::run()
+{
+    QTemporaryDir temporary(QString("%1/qelement-log-benchmark-XXXXXX").arg(this->directory));
+    if (!temporary.isValid())
+    {
+        return {{"error", temporary.errorString()}};
+    }
+
+    // logs like the hot paths, through QDebug and independent of the compiled log level
+    const QUrl url("element://localhost/#/room/!benchmark:localhost");
+    const auto measure = [&](int threads) {
+        std::vector<std::vector<double>> latencies(std::size_t(threads));
+        std::vector<std::thread> workers;
+        const auto perThread = this->messages / threads;
+
+        QElapsedTimer timer;
+        timer.start();
+        for (auto t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&, t]{
+                auto &values = latencies[std::size_t(t)];
+                values.reserve(std::size_t(perThread));
+                for (auto i = 0; i < perThread; ++i)
+                {
+                    const auto start = std::chrono::steady_clock::now();
+                    QMessageLogger(__FILE__, __LINE__, Q_FUNC_INFO).info() << "acceptNavigationRequest:" << url << i;
+                    values.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+                }
+            });
+        }
+        for (auto&& worker : workers)
+        {
+            worker.join();
+        }
+        const auto ms = double(timer.nsecsElapsed()) / 1e6;
+
+        std::vector<double> all;
+        for (auto&& values : latencies)
+        {
+            all.insert(all.end(), values.begin(), values.end());
+        }
+
+        return QJsonObject{
+            {"threads", threads},
+            {"messages", qint64(all.size())},
+            {"callerMs", ms},
+            {"p50", percentile(all, 0.5)},
+            {"p99", percentile(all, 0.99)},
+            {"max", percentile(all, 1.0)},
+        };
+    };
+
+    QJsonObject sync;
+    QJsonObject async;
+    for (auto threads : threadCounts)
+    {
+        const auto name = QString("threads%1").arg(threads);
+
+        syncFile = std::fopen(QFile::encodeName(temporary.filePath(name + "-sync.log")).constData(), "w");
+        if (!syncFile)
+        {
+            return {{"error", "unable to create the log file"}};
+        }
+        qInstallMessageHandler(syncHandler);
+        auto syncResult = measure(threads);
+        const auto syncMs = syncResult.value("callerMs").toDouble();
+        syncResult.insert("messagesPerSecond", syncMs > 0 ? syncResult.value("messages").toDouble() / syncMs * 1000 : 0);
+        sync.insert(name, syncResult);
+        qInstallMessageHandler(Log::messageHandler);
+        std::fclose(syncFile);
+        syncFile = nullptr;
+
+        if (!Log::setSink(Log::Sink::File, temporary.filePath(name + "-async.log")))
+        {
+            return {{"error", "unable to create the log file"}};
+        }
+        const auto dropped = Log::dropped();
+        auto result = measure(threads);
+
+        // the time until the drain thread has written everything
+        QElapsedTimer timer;
+        timer.start();
+        Log::flush();
+        const auto drainMs = double(timer.nsecsElapsed()) / 1e6;
+
+        // dropped messages weren't written and don't count towards the throughput,
+        // which includes the time until the last message was written like the synchronous handler
+        const auto droppedMessages = qint64(Log::dropped() - dropped);
+        const auto written = result.value("messages").toInteger() - droppedMessages;
+        const auto totalMs = result.value("callerMs").toDouble() + drainMs;
+        result.insert("drainMs", drainMs);
+        result.insert("dropped", droppedMessages);
+        result.insert("written", written);
+        result.insert("messagesPerSecond", totalMs > 0 ? double(written) / totalMs * 1000 : 0);
+        async.insert(name, result);
+    }
+
+    Log::setSink(Log::Sink::Console);
+
+    return {
+        {"messages", this->messages},
+        {"sync", sync},
+        {"async", async},
+    };
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QString>
+#include <QJsonObject>
+
+/**
+ * Measures the throughput and the latency of the callers of the asynchronous
+ * logger against a synchronous handler which writes each message with
+ * fprintf, with one and with several logging threads. Both write into files
+ * in a temporary directory, so the terminal doesn't distort the results.
+ *
+ * The throughput only counts written messages until the last one was
+ * written, messages dropped by the asynchronous logger are reported apart.
+ *
+ * Latencies are in microseconds, the caller and drain times are in milliseconds.
+ */
+class LogBenchmark
+{
+public:
+    /**
+     * The log files are created in a temporary directory inside of directory.
+     */
+    LogBenchmark(const QString &directory, int messages);
+
+    const QJsonObject run();
+
+private:
+    QString directory;
+    int messages;
+};
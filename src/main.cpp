@@ -5,21 +5,45 @@
 #include <QtConcurrentRun>
 #include <QMessageBox>
 #include <QLockFile>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QTimer>
 
+#include <algorithm>
 #include <vector>
 #include <string_view>
 
 #include "paths.hpp"
 #include "configmanager.hpp"
+#include "engineoptions.hpp"
 #include "browserwindow.hpp"
 #include "elementurlscheme.hpp"
+#include "profile.hpp"
+#include "instanceserver.hpp"
+#include "mediacache.hpp"
+#include "benchmark.hpp"
+#include "storageanalyzer.hpp"
+#include "stallwatchdog.hpp"
+#include "cryptobenchmark.hpp"
+#include "searchbenchmark.hpp"
+#include "pgotraining.hpp"
+#include "logbenchmark.hpp"
+#include "log.hpp"
+#include "consolelog.hpp"
+#include "externallinkstress.hpp"
+#include "mediacachecheck.hpp"
+#include "trace.hpp"
 
 constexpr const std::string_view appname{"QElement"};
 constexpr const std::string_view appversion{"1.3"};
 const Paths *paths = nullptr;
-ConfigManager *config = nullptr;
+ConfigManager *config = nullptr; // preferences of the first profile, used for process wide settings
+StallWatchdog *watchdog = nullptr;
 
-std::unique_ptr<QLockFile> instance_lock;
+std::vector<std::unique_ptr<QLockFile>> instance_locks;
+
+// keeps stdout clean for machine readable output
+bool log_to_stderr = false;
 
 #ifdef Q_OS_UNIX
 #include <csignal>
@@ -28,7 +52,7 @@ void sig_handler(int signal)
 {
     if (signal == SIGINT || signal == SIGTERM)
     {
-        if (instance_lock)
+        for (auto&& instance_lock : instance_locks)
         {
             instance_lock->unlock();
         }
@@ -38,20 +62,6 @@ void sig_handler(int signal)
 }
 #endif
 
-// force QDebug to print to console even when no tty is attached to avoid
-// cluttering the systemd journal on systemd-based distros
-void qdebug_force_console(QtMsgType type, const QMessageLogContext &context, const QString &msg)
-{
-    if (type == QtDebugMsg)
-    {
-        std::fprintf(stderr, "%s\n", msg.toStdString().c_str());
-    }
-    else
-    {
-        std::fprintf(stdout, "%s\n", msg.toStdString().c_str());
-    }
-}
-
 void show_error(const QString &message)
 {
     QMessageBox::critical(nullptr,
@@ -62,7 +72,7 @@ void show_error(const QString &message)
 bool is_already_running(const QString &instance_name = "default")
 {
     const auto tmp = QDir::tempPath();
-    instance_lock = std::make_unique<QLockFile>(QString("%1/%2").arg(tmp, "qelement-instance-"+instance_name+".lock"));
+    auto instance_lock = std::make_unique<QLockFile>(QString("%1/%2").arg(tmp, "qelement-instance-"+instance_name+".lock"));
 
     if (!instance_lock->tryLock(100))
     {
@@ -71,18 +81,32 @@ bool is_already_running(const QString &instance_name = "default")
     }
 
     // new instance created
+    instance_locks.push_back(std::move(instance_lock));
     return false;
 }
 
+void unlock_instances()
+{
+    for (auto&& instance_lock : instance_locks)
+    {
+        instance_lock->unlock();
+    }
+}
+
 int main(int argc, char **argv)
 {
-    qInstallMessageHandler(qdebug_force_console);
+    Trace::initialize(argc, argv);
+
+    // log to the console even when no tty is attached to avoid cluttering the
+    // systemd journal on systemd-based distros, unless the journal is selected
+    Log::initialize();
 
 #ifdef Q_OS_UNIX
     std::signal(SIGINT, sig_handler);
     std::signal(SIGTERM, sig_handler);
 #endif
 
+    TRACE_BEGIN("argument parsing");
     QStringList arguments;
     for (auto i = 0; i < argc; ++i)
     {
@@ -93,7 +117,7 @@ int main(int argc, char **argv)
     QList<QCommandLineOption> options{
         QCommandLineOption("help", QObject::tr("Show this help")),
         QCommandLineOption("minimized", QObject::tr("Start minimized to tray")),
-        QCommandLineOption("profile", QObject::tr("Profile to use"), "profile",
+        QCommandLineOption("profile", QObject::tr("Profile to use, can be given multiple times to run multiple profiles in one process"), "profile",
             #ifdef DEBUG_BUILD
                 "debug"
             #else
@@ -101,9 +125,30 @@ int main(int argc, char **argv)
             #endif
             ),
         QCommandLineOption("webapp-root", QObject::tr("Use alternative webapp root"), "webapp-root"),
+        QCommandLineOption("benchmark", QObject::tr("Measure the time to interactive offscreen, print the results as JSON and exit")),
+        QCommandLineOption("benchmark-runs", QObject::tr("Number of cold and warm benchmark runs"), "runs", "5"),
+        QCommandLineOption("trace-startup", QObject::tr("Write a Chrome trace of the startup to the given file on exit"), "file"),
+        QCommandLineOption("storage-report", QObject::tr("Print the disk usage of the profile storage by type and origin as JSON and exit")),
+        QCommandLineOption("compact-storage", QObject::tr("Prune the caches of the profile storage while the profile isn't running and exit, IndexedDB isn't compacted")),
+        QCommandLineOption("dump-console", QObject::tr("Print the recorded console messages of the web app and exit")),
+        QCommandLineOption("search-benchmark", QObject::tr("Index and search a generated corpus with the event index, print the results as JSON and exit"), "events"),
+        QCommandLineOption("media-cache-check", QObject::tr("Load media from the given media repository through an empty media cache offscreen, print the hits and misses as JSON and exit"), "url"),
+        QCommandLineOption("stress-external-links", QObject::tr("Open external links offscreen, check that the memory stays stable, print the results as JSON and exit"), "links"),
+        QCommandLineOption("log-benchmark", QObject::tr("Measure the logging throughput and latency, print the results as JSON and exit"), "messages"),
     };
+#ifdef NATIVE_CRYPTO_ENABLED
+    options.append(QCommandLineOption("crypto-benchmark", QObject::tr("Decrypt a synthetic backlog natively and with WASM offscreen, print the results as JSON and exit"), "events"));
+    options.append(QCommandLineOption("crypto-benchmark-wasm", QObject::tr("Directory of the matrix-sdk-crypto-wasm package for the WASM decryption of the crypto benchmark"), "directory"));
+#endif
     parser.addOptions(options);
+
+    // workload of the profile guided optimization build, see tools/pgo-build
+    QCommandLineOption pgoTraining("pgo-training");
+    pgoTraining.setFlags(QCommandLineOption::HiddenFromHelp);
+    parser.addOption(pgoTraining);
+    parser.addPositionalArgument("url", QObject::tr("matrix.to link to open"), "[url]");
     parser.process(arguments);
+    TRACE_END("argument parsing");
 
     if (parser.isSet("help"))
     {
@@ -136,39 +181,342 @@ int main(int argc, char **argv)
         return 0;
     }
 
-    // get profile to use
-    QString instance_name = parser.value("profile");
-    std::printf("using profile: %s\n", instance_name.toUtf8().constData());
+    // run the training workload without any profile and print the timings
+    if (parser.isSet(pgoTraining))
+    {
+        log_to_stderr = true;
+        Log::setConsoleStderr(true);
+        if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        }
+
+        QApplication app(argc, argv);
+        app.setApplicationName(appname.data());
+        PgoTraining training(2000);
+        const auto report = training.run();
+        std::printf("%s", QJsonDocument(report).toJson().constData());
+        return report.contains("error") ? 1 : 0;
+    }
+
+    // measure the event index without any profile, SQL drivers require an application instance
+    if (parser.isSet("search-benchmark"))
+    {
+        bool eventsOk = false;
+        const auto events = parser.value("search-benchmark").toInt(&eventsOk);
+        if (!eventsOk || events < 1)
+        {
+            std::fprintf(stderr, "invalid number of search benchmark events: %s\n", parser.value("search-benchmark").toUtf8().constData());
+            return 1;
+        }
+
+        log_to_stderr = true;
+        Log::setConsoleStderr(true);
+        QCoreApplication app(argc, argv);
+        SearchBenchmark bench(QDir::tempPath(), events);
+        const auto report = bench.run();
+        std::printf("%s", QJsonDocument(report).toJson().constData());
+        return report.contains("error") ? 1 : 0;
+    }
 
-    // check if application is already running and acquire a single instance lock
+    // compare the asynchronous logger with synchronous writes
+    if (parser.isSet("log-benchmark"))
+    {
+        bool messagesOk = false;
+        const auto messages = parser.value("log-benchmark").toInt(&messagesOk);
+        if (!messagesOk || messages < 4)
+        {
+            std::fprintf(stderr, "invalid number of log benchmark messages: %s\n", parser.value("log-benchmark").toUtf8().constData());
+            return 1;
+        }
+
+        log_to_stderr = true;
+        Log::setConsoleStderr(true);
+        LogBenchmark bench(QDir::tempPath(), messages);
+        const auto report = bench.run();
+        std::printf("%s", QJsonDocument(report).toJson().constData());
+        return report.contains("error") ? 1 : 0;
+    }
+
+    // get profiles to use, the first profile is the primary profile
+    auto instance_names = parser.values("profile");
+    instance_names.removeDuplicates();
+    const bool storageReport = parser.isSet("storage-report");
+    const bool compactStorage = parser.isSet("compact-storage");
+    const bool dumpConsole = parser.isSet("dump-console");
+    const bool stressExternalLinks = parser.isSet("stress-external-links");
+    const bool mediaCacheCheck = parser.isSet("media-cache-check");
+    log_to_stderr = parser.isSet("benchmark") || storageReport || compactStorage || dumpConsole || stressExternalLinks || mediaCacheCheck;
+#ifdef NATIVE_CRYPTO_ENABLED
+    const bool cryptoBenchmark = parser.isSet("crypto-benchmark");
+    log_to_stderr = log_to_stderr || cryptoBenchmark;
+#endif
+    Log::setConsoleStderr(log_to_stderr);
+    for (auto&& instance_name : instance_names)
+    {
+        std::fprintf(log_to_stderr ? stderr : stdout, "using profile: %s\n", instance_name.toUtf8().constData());
+    }
+
+    // check if application is already running and acquire a single instance lock per profile
     // qtwebengine corrupts its own storage on multiple instances of the process
     // also the internal webserver can't bind on the same port multiple times
-    if (is_already_running(instance_name))
+    // profiles which are already running are activated in the running process instead
+    TRACE_BEGIN("instance lock");
+    QStringList forward_commands;
+    if (!parser.isSet("minimized"))
+    {
+        forward_commands << "show";
+    }
+    for (auto&& url : parser.positionalArguments())
+    {
+        forward_commands << "open=" + url;
+    }
+
+    for (auto it = instance_names.begin(); it != instance_names.end();)
+    {
+        // the report and the console log are only read and work while the profile is running
+        if ((storageReport && !compactStorage) || dumpConsole)
+        {
+            break;
+        }
+
+        if (is_already_running(*it))
+        {
+            if (compactStorage)
+            {
+                std::fprintf(stderr, "profile %s is running, quit it before compacting its storage\n", it->toUtf8().constData());
+                TRACE_END("instance lock");
+                unlock_instances();
+                return 1;
+            }
+
+            if (!InstanceServer::forward(*it, forward_commands))
+            {
+                std::fprintf(stderr, "profile %s is already running\n", it->toUtf8().constData());
+            }
+            it = instance_names.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    if (instance_names.isEmpty())
     {
+        TRACE_END("instance lock");
         return 0;
     }
+    TRACE_END("instance lock");
+
+    // initialize application paths, the application name is required
+    // to resolve the standard paths before QApplication exists
+    QCoreApplication::setApplicationName(appname.data());
+    QCoreApplication::setApplicationVersion(appversion.data());
+    // the storage tools and the console log work on existing profiles and must not create one
+    TRACE_BEGIN("paths");
+    const bool existingProfiles = storageReport || compactStorage || dumpConsole;
+    std::unique_ptr<Paths> existingPaths;
+    if (existingProfiles)
+    {
+        existingPaths = std::make_unique<Paths>(QString(), false);
+    }
+    paths = existingProfiles ? existingPaths.get() : Paths::defaultInstance();
+    QStringList profilePaths;
+    QString inaccessibleProfile;
+    for (auto&& instance_name : instance_names)
+    {
+        profilePaths << paths->webEngineProfilePath(instance_name);
+        if (profilePaths.last().isEmpty() && inaccessibleProfile.isEmpty())
+        {
+            inaccessibleProfile = instance_name;
+        }
+    }
+    TRACE_END("paths");
+
+    // decode the console log, also after a crash
+    if (dumpConsole)
+    {
+        auto res = 0;
+        for (auto i = 0; i < instance_names.size(); ++i)
+        {
+            const auto file = QString("%1/%2").arg(profilePaths.at(i), "ConsoleLog");
+            std::printf("# profile %s\n", instance_names.at(i).toUtf8().constData());
+            if (profilePaths.at(i).isEmpty() || !ConsoleLog::dump(file, stdout))
+            {
+                std::fprintf(stderr, "no console log in profile %s\n", instance_names.at(i).toUtf8().constData());
+                res = 1;
+            }
+        }
+        return res;
+    }
+
+    // analyze and compact the storage without starting QtWebEngine
+    if (storageReport || compactStorage)
+    {
+        for (auto i = 0; i < instance_names.size(); ++i)
+        {
+            if (profilePaths.at(i).isEmpty())
+            {
+                std::fprintf(stderr, "profile %s doesn't exist or isn't accessible\n", instance_names.at(i).toUtf8().constData());
+                unlock_instances();
+                return 1;
+            }
+        }
+
+        QJsonArray reports;
+        for (auto i = 0; i < instance_names.size(); ++i)
+        {
+            const StorageAnalyzer analyzer(profilePaths.at(i));
+            auto report = analyzer.report();
+            report.insert("profile", instance_names.at(i));
+            if (compactStorage)
+            {
+                report.insert("reclaimed", analyzer.compact());
+                report.insert("bytesAfter", analyzer.report().value("bytes"));
+                report.insert("note", "IndexedDB isn't compacted, Chromium's LevelDB comparator isn't available outside of QtWebEngine");
+            }
+            reports.append(report);
+        }
+
+        std::printf("%s", QJsonDocument(reports).toJson().constData());
+        unlock_instances();
+        return 0;
+    }
+
+    // initialize config managers before QApplication to be able to
+    // pass engine options of the primary profile to QtWebEngine
+    TRACE_BEGIN("config manager");
+    std::vector<std::unique_ptr<ConfigManager>> configManagers;
+    if (inaccessibleProfile.isEmpty())
+    {
+        for (auto&& profilePath : profilePaths)
+        {
+            configManagers.push_back(std::make_unique<ConfigManager>(profilePath));
+        }
+        config = configManagers.front().get();
+    }
+    TRACE_END("config manager");
+
+    // the log of the process goes to the primary profile, machine readable modes keep it on stderr
+    if (config && !log_to_stderr)
+    {
+        const auto sink = Log::sinkFromString(config->logSink());
+        const auto file = QString("%1/%2").arg(profilePaths.front(), "Logs/qelement.log");
+        if (!Log::setSink(sink, file, qint64(std::max(1, config->logFileSize())) * 1024 * 1024, config->logFiles()))
+        {
+            qWarning() << "log sink" << config->logSink() << "is not available, logging to the console";
+        }
+    }
+
+    // translate engine options into Chromium switches
+    std::unique_ptr<EngineOptions> engineOptions;
+    QByteArrayList engineArguments;
+    if (config)
+    {
+        engineOptions = std::make_unique<EngineOptions>(config);
+        for (auto&& argument : engineOptions->arguments())
+        {
+            qDebug() << "engine option:" << argument;
+            engineArguments << argument.toUtf8();
+        }
+    }
 
     // append command line arguments
     std::vector<char*> args{argv, argc + argv};
     args.push_back(const_cast<char*>("--disable-logging")); // disable 3rd party log messages from QtWebEngine
+    for (auto&& argument : engineArguments)
+    {
+        args.push_back(argument.data());
+    }
     args.push_back(nullptr);
     int newArgc = int(args.size()) - 1;
 
+    // validate benchmark options
+    const bool benchmark = parser.isSet("benchmark");
+    bool benchmarkRunsOk = false;
+    const auto benchmarkRuns = parser.value("benchmark-runs").toInt(&benchmarkRunsOk);
+    if (benchmark)
+    {
+        if (!benchmarkRunsOk || benchmarkRuns < 1)
+        {
+            std::fprintf(stderr, "invalid number of benchmark runs: %s\n", parser.value("benchmark-runs").toUtf8().constData());
+            return 1;
+        }
+    }
+
+#ifdef NATIVE_CRYPTO_ENABLED
+    bool cryptoBenchmarkEventsOk = false;
+    const auto cryptoBenchmarkEvents = parser.value("crypto-benchmark").toInt(&cryptoBenchmarkEventsOk);
+    if (cryptoBenchmark && (!cryptoBenchmarkEventsOk || cryptoBenchmarkEvents < 1))
+    {
+        std::fprintf(stderr, "invalid number of crypto benchmark events: %s\n", parser.value("crypto-benchmark").toUtf8().constData());
+        return 1;
+    }
+#else
+    const bool cryptoBenchmark = false;
+#endif
+
+    bool stressLinksOk = false;
+    const auto stressLinks = parser.value("stress-external-links").toInt(&stressLinksOk);
+    if (stressExternalLinks && (!stressLinksOk || stressLinks < 1))
+    {
+        std::fprintf(stderr, "invalid number of external links: %s\n", parser.value("stress-external-links").toUtf8().constData());
+        return 1;
+    }
+
+    const QUrl mediaRepository(parser.value("media-cache-check"));
+    if (mediaCacheCheck && (!mediaRepository.isValid() || (mediaRepository.scheme() != "http" && mediaRepository.scheme() != "https")))
+    {
+        std::fprintf(stderr, "invalid media repository url: %s\n", parser.value("media-cache-check").toUtf8().constData());
+        return 1;
+    }
+
+    // benchmarking doesn't need a display
+    if ((benchmark || cryptoBenchmark || stressExternalLinks || mediaCacheCheck) && !qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
     // setup element:// url scheme
+    // the scheme must be secure for Chromium to treat the bundles like regular
+    // web content, the other flags let the service worker of element-web fetch
+    // and cache its files
+    TRACE_BEGIN("scheme registration");
     QWebEngineUrlScheme scheme(ElementUrlScheme::schemeName());
     scheme.setSyntax(QWebEngineUrlScheme::Syntax::Host);
     scheme.setDefaultPort(QWebEngineUrlScheme::PortUnspecified);
-    scheme.setFlags(QWebEngineUrlScheme::SecureScheme);
+    // the content security policy of element-web still applies to its own files
+    auto schemeFlags = QWebEngineUrlScheme::Flags(QWebEngineUrlScheme::SecureScheme) |
+                       QWebEngineUrlScheme::CorsEnabled;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 6, 0)
+    schemeFlags |= QWebEngineUrlScheme::FetchApiAllowed;
+#endif
+    if (config && config->serviceWorker())
+    {
+        schemeFlags |= QWebEngineUrlScheme::ServiceWorkersAllowed;
+    }
+    scheme.setFlags(schemeFlags);
     QWebEngineUrlScheme::registerScheme(scheme);
 
+    // setup qelement-media: url scheme, media is loaded cross-origin from the page
+    QWebEngineUrlScheme mediaScheme(MediaCache::schemeName());
+    mediaScheme.setSyntax(QWebEngineUrlScheme::Syntax::Path);
+    mediaScheme.setFlags(QWebEngineUrlScheme::SecureScheme | QWebEngineUrlScheme::CorsEnabled);
+    QWebEngineUrlScheme::registerScheme(mediaScheme);
+    TRACE_END("scheme registration");
+
     // initialize application with modified arguments
+    TRACE_BEGIN("QApplication");
     QApplication a(newArgc, args.data());
     a.setApplicationName(appname.data());
     a.setApplicationVersion(appversion.data());
     a.setWindowIcon(QIcon(":/element.ico"));
+    TRACE_END("QApplication");
 
     // load embedded translations for current locale using QRC language and alias magic :)
     // falls back to embedded English strings if no translation was found
+    TRACE_BEGIN("translator");
     auto translator = std::make_unique<QTranslator>();
     if (translator->load(QLocale(), ":/i18n/lang.qm"))
     {
@@ -178,59 +526,136 @@ int main(int argc, char **argv)
     {
         translator.reset();
     }
+    TRACE_END("translator");
 
-    // initialize application paths
-    paths = Paths::defaultInstance();
-
-    // create and validate data path
-    if (paths->webEngineProfilePath(instance_name).isEmpty())
+    // validate data path
+    if (!config)
     {
         show_error(QObject::tr("Unable to access directory: %1").arg(
-            paths->webEngineProfilePath(instance_name, false)));
+            paths->webEngineProfilePath(inaccessibleProfile, false)));
+        unlock_instances();
         return 1;
     }
 
-    // initialize config manager
-    auto configManager = std::make_unique<ConfigManager>(paths->webEngineProfilePath(instance_name));
-    config = configManager.get();
+    // the watchers of the preferences need the event dispatcher of QApplication
+    for (auto&& configManager : configManagers)
+    {
+        configManager->startWatching();
+    }
 
-    // check if an alternative webroot was requested
-    auto webappRoot = config->webroot();
-    const auto alternativeWebroot = parser.value("webapp-root");
-    if (!alternativeWebroot.isEmpty())
+    // create all profiles, they share the QtWebEngine instance of this process
+    TRACE_BEGIN("profile creation");
+    std::vector<std::unique_ptr<Profile>> profiles;
+    for (auto i = 0; i < instance_names.size(); ++i)
     {
-        qDebug() << "using alternative webroot:" << alternativeWebroot;
-        webappRoot = alternativeWebroot;
+        profiles.push_back(std::make_unique<Profile>(instance_names.at(i), std::move(configManagers.at(i)), parser.value("webapp-root")));
     }
+    auto primaryProfile = profiles.front().get();
+    TRACE_END("profile creation");
 
-    // register element:// url scheme
-    auto elementUrlHandler = std::make_unique<ElementUrlScheme>(webappRoot);
-    QWebEngineProfile web_engine_profile(instance_name, &a);
-    web_engine_profile.setPersistentStoragePath(paths->webEngineProfilePath(instance_name));
-    web_engine_profile.installUrlSchemeHandler(ElementUrlScheme::schemeName(), elementUrlHandler.get());
+    // measure the time to interactive, print the results and exit
+    if (benchmark)
+    {
+        Benchmark bench(primaryProfile->webEngineProfile(), primaryProfile->urlScheme());
+        QObject::connect(&bench, &Benchmark::finished, &a, [&](bool success){
+            a.exit(success ? 0 : 1);
+        });
+        bench.start(QUrl("element://localhost/"), benchmarkRuns);
+
+        const auto res = a.exec();
+        std::printf("%s", QJsonDocument(bench.report()).toJson().constData());
+        unlock_instances();
+        return res;
+    }
 
-    QObject::connect(config, &ConfigManager::configUpdated, [&](const ConfigManager::Key &key){
-        if (key == ConfigManager::Key::Webroot)
-        {
-            qDebug() << "webroot updated to:" << config->webroot();
-            elementUrlHandler->changeRoot(config->webroot());
-        }
-    });
+#ifdef NATIVE_CRYPTO_ENABLED
+    // compare the native and the WASM decryption, print the results and exit
+    if (cryptoBenchmark)
+    {
+        CryptoBenchmark bench(cryptoBenchmarkEvents, parser.value("crypto-benchmark-wasm"));
+        QObject::connect(&bench, &CryptoBenchmark::finished, &a, [&](bool success){
+            a.exit(success ? 0 : 1);
+        });
+        QTimer::singleShot(0, &bench, &CryptoBenchmark::start);
+
+        const auto res = a.exec();
+        std::printf("%s", QJsonDocument(bench.report()).toJson().constData());
+        unlock_instances();
+        return res;
+    }
+#endif
 
-    // load the browser window
-    BrowserWindow webview(instance_name, &web_engine_profile);
+    // open external links from a page and check the memory, print the results and exit
+    if (stressExternalLinks)
+    {
+        ExternalLinkStress stress(stressLinks);
+        QObject::connect(&stress, &ExternalLinkStress::finished, &a, [&](bool success){
+            a.exit(success ? 0 : 1);
+        });
+        QTimer::singleShot(0, &stress, &ExternalLinkStress::start);
+
+        const auto res = a.exec();
+        std::printf("%s", QJsonDocument(stress.report()).toJson().constData());
+        unlock_instances();
+        return res;
+    }
+
+    // load media through an empty media cache, print the results and exit
+    if (mediaCacheCheck)
+    {
+        MediaCacheCheck check(mediaRepository);
+        QObject::connect(&check, &MediaCacheCheck::finished, &a, [&](bool success){
+            a.exit(success ? 0 : 1);
+        });
+        QTimer::singleShot(0, &check, &MediaCacheCheck::start);
+
+        const auto res = a.exec();
+        std::printf("%s", QJsonDocument(check.report()).toJson().constData());
+        unlock_instances();
+        return res;
+    }
+
+    // detect stalls of the gui thread, logs to the primary profile
+    std::unique_ptr<StallWatchdog> stallWatchdog;
+    if (config->diagnosticsWatchdogEnabled())
+    {
+        stallWatchdog = std::make_unique<StallWatchdog>(profilePaths.front(), config->diagnosticsStallThreshold(), config->diagnosticsStackCapture());
+        watchdog = stallWatchdog.get();
+    }
+
+    // load the browser windows
+    TRACE_BEGIN("BrowserWindow construction");
+    QList<BrowserWindow*> windows;
+    for (auto&& profile : profiles)
+    {
+        windows.append(profile->window());
+    }
+    for (auto&& window : windows)
+    {
+        window->setProfileWindows(windows);
+    }
+    TRACE_END("BrowserWindow construction");
 
-    // show browser window
+    // show browser windows
     if (!parser.isSet("minimized"))
     {
-        webview.show();
+        for (auto&& window : windows)
+        {
+            window->show();
+        }
+    }
+
+    // open requested urls in the primary profile
+    for (auto&& url : parser.positionalArguments())
+    {
+        windows.front()->openUrl(QUrl(url));
     }
 
     // enter qt event loop
     const auto res = a.exec();
 
-    // remove single instance lock
-    instance_lock->unlock();
+    // remove single instance locks
+    unlock_instances();
 
     return res;
 }
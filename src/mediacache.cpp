@@ -0,0 +1,375 @@
+#include "mediacache.hpp"
+
+#include <QWebEngineUrlRequestJob>
+#include <QWebEngineUrlRequestInfo>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QCryptographicHash>
+#include <QRegularExpression>
+#include <QUrlQuery>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QBuffer>
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+// media larger than this fraction of the cache size is never stored
+constexpr const qint64 maxEntryFraction = 10;
+
+// evict down to this percentage of the cache size to avoid evicting on every store
+constexpr const qint64 evictionTarget = 90;
+
+// authorizations of redirects which were never followed are dropped after this time in ms
+constexpr const qint64 authorizationLifetime = 60000;
+
+// and at most this many are kept
+constexpr const int maxAuthorizations = 256;
+
+// the legacy unauthenticated and the authenticated media repository endpoints,
+// both serve the same media and share the cache entries
+static const QRegularExpression mediaPath(R"(^/_matrix/(?:media/(?:r0|v3)|client/v1/media)/(download|thumbnail)/([^/]+)/([^/]+))");
+
+static bool isAuthenticated(const QUrl &url)
+{
+    return url.path().startsWith("/_matrix/client/");
+}
+
+MediaCache::MediaCache(const QString &directory, qint64 maxSize, QObject *parent)
+    : QWebEngineUrlSchemeHandler(parent)
+{
+    this->directory = directory;
+    this->maxSize = maxSize;
+    this->network = std::make_unique<QNetworkAccessManager>();
+
+    QDir(this->directory).mkpath(".");
+    this->loadIndex();
+}
+
+MediaCache::~MediaCache()
+{
+}
+
+const QString MediaCache::cacheKey(const QUrl &url)
+{
+    const auto match = mediaPath.match(url.path());
+    if (!match.hasMatch())
+    {
+        return {};
+    }
+
+    // mxc://<server>/<media id> as served by the host of the url, media of another
+    // host claiming the same mxc url must not end up in the entries of the homeserver
+    auto key = QString("%1://%2:%3/%4/%5").arg(
+        url.scheme(),
+        url.host(),
+        QString::number(url.port(url.scheme() == "https" ? 443 : 80)),
+        match.captured(2),
+        match.captured(3));
+
+    if (match.captured(1) == "thumbnail")
+    {
+        const QUrlQuery query(url);
+        key.append(QString("?width=%1&height=%2&method=%3&animated=%4").arg(
+            query.queryItemValue("width"),
+            query.queryItemValue("height"),
+            query.queryItemValue("method"),
+            query.queryItemValue("animated")));
+    }
+
+    return key;
+}
+
+const QUrl MediaCache::cacheUrl(const QUrl &url)
+{
+    const auto encoded = url.toEncoded().toBase64(QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals);
+    return QUrl(QString("%1:%2").arg(QString::fromUtf8(MediaCache::schemeName()), QString::fromLatin1(encoded)));
+}
+
+void MediaCache::requestStarted(QWebEngineUrlRequestJob *request)
+{
+    const auto encoded = request->requestUrl().path().toLatin1();
+    const auto url = QUrl::fromEncoded(QByteArray::fromBase64(encoded, QByteArray::Base64UrlEncoding));
+    const auto key = MediaCache::cacheKey(url);
+    const auto authorization = this->authorizations.take(url).header;
+
+    if (key.isEmpty() || (url.scheme() != "https" && url.scheme() != "http"))
+    {
+        request->fail(QWebEngineUrlRequestJob::UrlInvalid);
+        return;
+    }
+
+    const auto hash = QString::fromLatin1(QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha256).toHex());
+
+    // cache hit
+    const auto entry = this->index.find(hash);
+    if (entry != this->index.end())
+    {
+        if (this->reply(request, this->filePath(hash)))
+        {
+            ++this->_hits;
+            entry->second.lastAccess = QDateTime::currentMSecsSinceEpoch();
+            emit served(url, entry->second.size);
+            return;
+        }
+
+        // the file was removed behind our back, fetch it again
+        this->_size -= entry->second.size;
+        this->index.erase(entry);
+    }
+
+    ++this->_misses;
+
+    // coalesce concurrent requests of the same media
+    auto &jobs = this->pending[hash];
+    jobs.append(request);
+    if (jobs.size() > 1)
+    {
+        return;
+    }
+
+    // authenticated media is fetched with the access token of the page
+    QNetworkRequest networkRequest(url);
+    if (!authorization.isEmpty())
+    {
+        networkRequest.setRawHeader("Authorization", authorization);
+    }
+
+    auto reply = this->network->get(networkRequest);
+    connect(reply, &QNetworkReply::finished, this, [this, hash, reply]{
+        this->fetched(hash, reply);
+    });
+}
+
+bool MediaCache::setAuthorization(const QUrl &url, const QByteArray &authorization)
+{
+    const auto now = QDateTime::currentMSecsSinceEpoch();
+
+    // the page may cancel a request before the redirect is followed
+    for (auto it = this->authorizations.begin(); it != this->authorizations.end();)
+    {
+        it = now - it->time > authorizationLifetime ? this->authorizations.erase(it) : std::next(it);
+    }
+    if (this->authorizations.size() >= maxAuthorizations && !this->authorizations.contains(url))
+    {
+        qWarning() << "media cache: too many pending authenticated requests, not caching" << url.path();
+        return false;
+    }
+
+    this->authorizations.insert(url, {authorization, now});
+    return true;
+}
+
+qint64 MediaCache::size() const
+{
+    return this->_size;
+}
+
+qint64 MediaCache::hits() const
+{
+    return this->_hits;
+}
+
+qint64 MediaCache::misses() const
+{
+    return this->_misses;
+}
+
+void MediaCache::loadIndex()
+{
+    const auto files = QDir(this->directory).entryInfoList(QDir::Files | QDir::NoDotAndDotDot);
+    for (auto&& file : files)
+    {
+        this->index[file.fileName()] = {file.size(), file.lastModified().toMSecsSinceEpoch()};
+        this->_size += file.size();
+    }
+
+    qDebug() << "media cache:" << this->index.size() << "entries," << this->_size << "bytes";
+}
+
+bool MediaCache::reply(QWebEngineUrlRequestJob *request, const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    // keep the lru order across restarts
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+
+    // entries start with the mime type on the first line
+    const auto mimeType = file.readLine().trimmed();
+    auto buffer = new QBuffer(this);
+    buffer->setData(file.readAll());
+    connect(request, &QObject::destroyed, buffer, &QObject::deleteLater);
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 7, 0)
+    // media is also loaded with fetch() from the element:// origin
+    request->setAdditionalResponseHeaders({{"Access-Control-Allow-Origin", "*"}});
+#endif
+
+    request->reply(mimeType, buffer);
+    return true;
+}
+
+void MediaCache::fetched(const QString &key, QNetworkReply *reply)
+{
+    reply->deleteLater();
+    const auto jobs = this->pending.take(key);
+
+    const auto status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (reply->error() != QNetworkReply::NoError || status != 200)
+    {
+        const auto error = status == 404 ? QWebEngineUrlRequestJob::UrlNotFound : QWebEngineUrlRequestJob::RequestFailed;
+        for (auto&& job : jobs)
+        {
+            if (job)
+            {
+                job->fail(error);
+            }
+        }
+        return;
+    }
+
+    auto mimeType = reply->header(QNetworkRequest::ContentTypeHeader).toByteArray();
+    if (mimeType.isEmpty())
+    {
+        mimeType = "application/octet-stream";
+    }
+
+    const auto data = reply->readAll();
+    this->store(key, mimeType, data);
+
+    // media too large for the cache is served from memory
+    for (auto&& job : jobs)
+    {
+        if (job && !this->reply(job, this->filePath(key)))
+        {
+            auto buffer = new QBuffer(this);
+            buffer->setData(data);
+            connect(job, &QObject::destroyed, buffer, &QObject::deleteLater);
+            job->reply(mimeType, buffer);
+        }
+
+        if (job)
+        {
+            emit served(reply->url(), data.size());
+        }
+    }
+}
+
+void MediaCache::store(const QString &key, const QByteArray &mimeType, const QByteArray &data)
+{
+    if (data.size() > this->maxSize / maxEntryFraction)
+    {
+        return;
+    }
+
+    QSaveFile file(this->filePath(key));
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return;
+    }
+
+    file.write(mimeType + '\n');
+    file.write(data);
+    if (!file.commit())
+    {
+        return;
+    }
+
+    const auto size = qint64(mimeType.size() + 1 + data.size());
+    this->index[key] = {size, QDateTime::currentMSecsSinceEpoch()};
+    this->_size += size;
+
+    if (this->_size > this->maxSize)
+    {
+        this->evict();
+    }
+}
+
+void MediaCache::evict()
+{
+    std::vector<std::pair<qint64, QString>> entries;
+    entries.reserve(this->index.size());
+    for (auto&& [key, entry] : this->index)
+    {
+        entries.emplace_back(entry.lastAccess, key);
+    }
+    std::sort(entries.begin(), entries.end());
+
+    const auto target = this->maxSize * evictionTarget / 100;
+    for (auto&& [lastAccess, key] : entries)
+    {
+        if (this->_size <= target)
+        {
+            break;
+        }
+
+        // entries with pending requests are still being served
+        if (this->pending.contains(key))
+        {
+            continue;
+        }
+
+        QFile::remove(this->filePath(key));
+        this->_size -= this->index.at(key).size;
+        this->index.erase(key);
+    }
+}
+
+const QString MediaCache::filePath(const QString &key) const
+{
+    return QString("%1/%2").arg(this->directory, key);
+}
+
+MediaCacheInterceptor::MediaCacheInterceptor(MediaCache *cache, QObject *parent)
+    : QWebEngineUrlRequestInterceptor(parent)
+{
+    this->cache = cache;
+}
+
+void MediaCacheInterceptor::interceptRequest(QWebEngineUrlRequestInfo &info)
+{
+    if (info.requestMethod() != "GET")
+    {
+        return;
+    }
+
+    const auto url = info.requestUrl();
+    if ((url.scheme() != "https" && url.scheme() != "http") || MediaCache::cacheKey(url).isEmpty())
+    {
+        return;
+    }
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 7, 0)
+    // fetch() from the element:// origin is cross-origin to qelement-media: and fails
+    // without Access-Control-Allow-Origin, which can't be set before Qt 6.7
+    if (info.resourceType() == QWebEngineUrlRequestInfo::ResourceTypeXhr)
+    {
+        return;
+    }
+#endif
+
+    // the redirect drops the request headers, the cache fetches misses with the token of the page
+    if (isAuthenticated(url))
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(6, 7, 0)
+        const auto authorization = info.httpHeaders().value("Authorization");
+        if (authorization.isEmpty() || !this->cache->setAuthorization(url, authorization))
+        {
+            return;
+        }
+#else
+        // authenticated media is only loaded with fetch()
+        return;
+#endif
+    }
+
+    info.redirect(MediaCache::cacheUrl(url));
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <QWebEngineUrlSchemeHandler>
+#include <QWebEngineUrlRequestInterceptor>
+#include <QPointer>
+#include <QHash>
+
+#include <unordered_map>
+#include <memory>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QWebEngineUrlRequestJob;
+
+/**
+ * Persistent cache for Matrix media on disk.
+ *
+ * Matrix media is content-addressed (mxc://server/id) and therefore
+ * immutable, so hits are served without any network round trip.
+ * The MediaCacheInterceptor redirects media repository requests of the
+ * page to the qelement-media: scheme handled by this class, misses are
+ * fetched from the original url and stored on disk. The size of the
+ * cache directory is bounded, least recently used entries are evicted.
+ */
+class MediaCache : public QWebEngineUrlSchemeHandler
+{
+    Q_OBJECT
+
+public:
+    MediaCache(const QString &directory, qint64 maxSize, QObject *parent = nullptr);
+    ~MediaCache();
+
+    static const QByteArray schemeName()
+    {
+        return "qelement-media";
+    }
+
+    /**
+     * Returns the cache key of a media repository url or an empty string
+     * when the url isn't cacheable. The key includes the host serving the
+     * media, thumbnails are keyed by their parameters.
+     */
+    static const QString cacheKey(const QUrl &url);
+
+    /**
+     * Url of the given media repository url in the qelement-media: scheme.
+     */
+    static const QUrl cacheUrl(const QUrl &url);
+
+    void requestStarted(QWebEngineUrlRequestJob *request) override;
+
+    /**
+     * Authorization header for fetching the authenticated media url on a miss,
+     * it is used once by the next request of the url. Unused headers expire,
+     * returns false when too many are pending and the url mustn't be redirected.
+     */
+    bool setAuthorization(const QUrl &url, const QByteArray &authorization);
+
+    qint64 size() const;
+    qint64 hits() const;
+    qint64 misses() const;
+
+signals:
+    /**
+     * Emitted for every request answered with media, url is the original media repository url.
+     */
+    void served(const QUrl &url, qint64 bytes);
+
+private:
+    struct Entry
+    {
+        qint64 size;
+        qint64 lastAccess;
+    };
+
+    struct Authorization
+    {
+        QByteArray header;
+        qint64 time;
+    };
+
+    void loadIndex();
+    bool reply(QWebEngineUrlRequestJob *request, const QString &file);
+    void fetched(const QString &key, QNetworkReply *reply);
+    void store(const QString &key, const QByteArray &mimeType, const QByteArray &data);
+    void evict();
+    const QString filePath(const QString &key) const;
+
+    QString directory;
+    qint64 maxSize;
+    qint64 _size = 0;
+    qint64 _hits = 0;
+    qint64 _misses = 0;
+
+    std::unordered_map<QString, Entry> index;
+    QHash<QString, QList<QPointer<QWebEngineUrlRequestJob>>> pending;
+    QHash<QUrl, Authorization> authorizations;
+    std::unique_ptr<QNetworkAccessManager> network;
+};
+
+/**
+ * Redirects cacheable media repository requests to the media cache.
+ */
+class MediaCacheInterceptor : public QWebEngineUrlRequestInterceptor
+{
+    Q_OBJECT
+
+public:
+    explicit MediaCacheInterceptor(MediaCache *cache, QObject *parent = nullptr);
+
+    void interceptRequest(QWebEngineUrlRequestInfo &info) override;
+
+private:
+    MediaCache *cache;
+};
@@ -0,0 +1,163 @@
+#include "mediacachecheck.hpp"
+#include "mediacache.hpp"
+
+#include <QWebEngineProfile>
+#include <QWebEnginePage>
+#include <QTimer>
+#include <QDebug>
+
+#include <iterator>
+
+// small enough that the fill phase evicts, media of the stand-in are 64 KiB
+constexpr const qint64 cacheSize = 1024 * 1024;
+
+// give up when the media of a phase aren't loaded in time
+constexpr const int phaseTimeout = 30000;
+
+namespace
+{
+    struct Phase
+    {
+        const char *name;
+        int first;
+        int count;
+        bool hits;
+    };
+
+    // the phases in order, all media of a phase either hit or miss
+    constexpr const Phase phases[] = {
+        {"miss",    0,  8, false},
+        {"hit",     0,  8, true},
+        {"fill",    8, 24, false},
+        {"evicted", 0,  8, false},
+    };
+}
+
+MediaCacheCheck::MediaCacheCheck(const QUrl &server, QObject *parent)
+    : QObject(parent)
+{
+    this->server = server;
+
+    this->timeout = std::make_unique<QTimer>();
+    this->timeout->setSingleShot(true);
+    this->timeout->setInterval(phaseTimeout);
+    connect(this->timeout.get(), &QTimer::timeout, this, [this]{
+        qWarning() << "media cache check: the media weren't loaded within" << phaseTimeout << "ms";
+        this->finish(false);
+    });
+}
+
+MediaCacheCheck::~MediaCacheCheck()
+{
+    this->timeout->stop();
+
+    // pages must be gone before their profile is deleted
+    this->page.reset();
+    this->profile.reset();
+}
+
+void MediaCacheCheck::start()
+{
+    if (!this->directory.isValid())
+    {
+        qWarning() << "media cache check: unable to create a temporary directory";
+        this->finish(false);
+        return;
+    }
+
+    this->cache = std::make_unique<MediaCache>(this->directory.path(), cacheSize);
+    this->interceptor = std::make_unique<MediaCacheInterceptor>(this->cache.get());
+
+    // off-the-record profiles keep everything in memory and start empty
+    this->profile = std::make_unique<QWebEngineProfile>();
+    this->profile->installUrlSchemeHandler(MediaCache::schemeName(), this->cache.get());
+    this->profile->setUrlRequestInterceptor(this->interceptor.get());
+
+    this->page = std::make_unique<QWebEnginePage>(this->profile.get());
+    connect(this->page.get(), &QWebEnginePage::loadFinished, this, &MediaCacheCheck::loadFinished);
+
+    this->nextPhase();
+}
+
+const QJsonObject MediaCacheCheck::report() const
+{
+    return {
+        {"server", this->server.toString()},
+        {"cacheSize", cacheSize},
+        {"success", this->success},
+        {"phases", this->phases},
+    };
+}
+
+void MediaCacheCheck::nextPhase()
+{
+    ++this->phase;
+    if (this->phase == int(std::size(phases)))
+    {
+        this->finish(true);
+        return;
+    }
+
+    this->hits = this->cache->hits();
+    this->misses = this->cache->misses();
+
+    // the phase in the query keeps Chromium from reusing the images of the previous phase,
+    // the cache key only consists of the host, the server and the media id
+    const auto &phase = phases[this->phase];
+    QString html("<!DOCTYPE html><html><body>\n");
+    for (auto i = phase.first; i < phase.first + phase.count; ++i)
+    {
+        html.append(QString("<img src=\"/_matrix/media/v3/download/localhost/media%1?phase=%2\">\n").arg(i).arg(phase.name));
+    }
+    html.append("</body></html>\n");
+
+    this->timeout->start();
+    this->page->setHtml(html, this->server);
+}
+
+void MediaCacheCheck::loadFinished(bool ok)
+{
+    if (!this->timeout->isActive())
+    {
+        return;
+    }
+    this->timeout->stop();
+
+    if (!ok)
+    {
+        qWarning() << "media cache check: failed to load the media of" << phases[this->phase].name;
+        this->finish(false);
+        return;
+    }
+
+    const auto &phase = phases[this->phase];
+    const auto hits = this->cache->hits() - this->hits;
+    const auto misses = this->cache->misses() - this->misses;
+
+    const auto phaseOk = hits + misses == phase.count && (phase.hits ? hits : misses) == phase.count && this->cache->size() <= cacheSize;
+    this->phases.append(QJsonObject{
+        {"name", phase.name},
+        {"media", phase.count},
+        {"hits", hits},
+        {"misses", misses},
+        {"size", this->cache->size()},
+        {"success", phaseOk},
+    });
+
+    if (!phaseOk)
+    {
+        qWarning() << "media cache check:" << phase.name << "had" << hits << "hits and" << misses << "misses";
+        this->finish(false);
+        return;
+    }
+
+    // don't load the next page from within the signal of the current one
+    QTimer::singleShot(0, this, &MediaCacheCheck::nextPhase);
+}
+
+void MediaCacheCheck::finish(bool success)
+{
+    this->timeout->stop();
+    this->success = success;
+    emit finished(success);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QObject>
+#include <QUrl>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QTemporaryDir>
+
+#include <memory>
+
+class QWebEngineProfile;
+class QWebEnginePage;
+class QTimer;
+class MediaCache;
+class MediaCacheInterceptor;
+
+/**
+ * Loads media from a media repository offscreen through a media cache in a
+ * temporary directory and records the hits, misses and the cache size of
+ * every phase. Used by tools/media-cache-check with a local stand-in for
+ * the media repository.
+ *
+ *  - miss:     the first media are loaded, all miss
+ *  - hit:      the same media again, all hit
+ *  - fill:     more media than fit, the least recently used ones are evicted
+ *  - evicted:  the first media again, all miss
+ */
+class MediaCacheCheck : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MediaCacheCheck(const QUrl &server, QObject *parent = nullptr);
+    ~MediaCacheCheck();
+
+    void start();
+
+    const QJsonObject report() const;
+
+signals:
+    void finished(bool success);
+
+private:
+    void nextPhase();
+    void loadFinished(bool ok);
+    void finish(bool success);
+
+    QUrl server;
+    QTemporaryDir directory;
+    int phase = -1;
+    qint64 hits = 0;
+    qint64 misses = 0;
+    QJsonArray phases;
+    bool success = false;
+
+    std::unique_ptr<MediaCache> cache;
+    std::unique_ptr<MediaCacheInterceptor> interceptor;
+    std::unique_ptr<QWebEngineProfile> profile;
+    std::unique_ptr<QWebEnginePage> page;
+    std::unique_ptr<QTimer> timeout;
+};
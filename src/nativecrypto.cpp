@@ -0,0 +1,202 @@
+#include "nativecrypto.hpp"
+
+#ifdef NATIVE_CRYPTO_ENABLED
+
+#include <QtConcurrentMap>
+#include <QFutureWatcher>
+#include <QDebug>
+
+#include <olm/olm.h>
+
+#include <vector>
+
+struct NativeCrypto::Session
+{
+    explicit Session()
+        : memory(olm_inbound_group_session_size()),
+          session(olm_inbound_group_session(memory.data()))
+    {
+    }
+
+    ~Session()
+    {
+        olm_clear_inbound_group_session(this->session);
+    }
+
+    std::vector<uint8_t> memory;
+    OlmInboundGroupSession *session;
+    std::mutex mutex;
+};
+
+struct NativeCrypto::Group
+{
+    std::shared_ptr<Session> session;
+    QList<qsizetype> indexes;
+    QVariantList events;
+};
+
+NativeCrypto::NativeCrypto(int threads, QObject *parent)
+    : QObject(parent)
+{
+    if (threads > 0)
+    {
+        this->pool.setMaxThreadCount(threads);
+    }
+}
+
+NativeCrypto::~NativeCrypto()
+{
+    this->pool.waitForDone();
+}
+
+bool NativeCrypto::importSession(const QString &sessionId, const QString &key, bool exported)
+{
+    auto session = std::make_shared<Session>();
+    const auto keyData = key.toUtf8();
+    const auto keyBytes = reinterpret_cast<const uint8_t*>(keyData.constData());
+
+    const auto result = exported ?
+        olm_import_inbound_group_session(session->session, keyBytes, std::size_t(keyData.size())) :
+        olm_init_inbound_group_session(session->session, keyBytes, std::size_t(keyData.size()));
+
+    if (result == olm_error())
+    {
+        qWarning() << "crypto: unable to import session" << sessionId << olm_inbound_group_session_last_error(session->session);
+        return false;
+    }
+
+    std::lock_guard lock(this->mutex);
+    this->sessions[sessionId] = session;
+    return true;
+}
+
+bool NativeCrypto::hasSession(const QString &sessionId) const
+{
+    std::lock_guard lock(this->mutex);
+    return this->sessions.find(sessionId) != this->sessions.end();
+}
+
+int NativeCrypto::decryptBatch(const QVariantList &events)
+{
+    const auto batchId = this->nextBatchId++;
+    const auto count = events.size();
+
+    auto watcher = new QFutureWatcher<QVariantList>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, batchId, count]{
+        emit batchDecrypted(batchId, NativeCrypto::merge(watcher->future().results(), count));
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::mapped(&this->pool, this->groupBySession(events), &NativeCrypto::decryptGroup));
+
+    return batchId;
+}
+
+const QVariantList NativeCrypto::decrypt(const QVariantList &events)
+{
+    const auto results = QtConcurrent::blockingMapped<QList<QVariantList>>(&this->pool, this->groupBySession(events), &NativeCrypto::decryptGroup);
+    return NativeCrypto::merge(results, events.size());
+}
+
+const QList<NativeCrypto::Group> NativeCrypto::groupBySession(const QVariantList &events) const
+{
+    QHash<QString, qsizetype> groupIndex;
+    QList<Group> groups;
+
+    std::lock_guard lock(this->mutex);
+    for (qsizetype i = 0; i < events.size(); ++i)
+    {
+        const auto event = events.at(i).toMap();
+        const auto sessionId = event.value("sessionId").toString();
+
+        auto it = groupIndex.find(sessionId);
+        if (it == groupIndex.end())
+        {
+            const auto session = this->sessions.find(sessionId);
+            groups.append({session != this->sessions.end() ? session->second : nullptr, {}, {}});
+            it = groupIndex.insert(sessionId, groups.size() - 1);
+        }
+
+        auto &group = groups[it.value()];
+        group.indexes.append(i);
+        group.events.append(event);
+    }
+
+    return groups;
+}
+
+const QVariantList NativeCrypto::decryptGroup(const Group &group)
+{
+    QVariantList results;
+    results.reserve(group.events.size());
+
+    std::unique_lock<std::mutex> lock;
+    if (group.session)
+    {
+        lock = std::unique_lock(group.session->mutex);
+    }
+
+    for (qsizetype i = 0; i < group.events.size(); ++i)
+    {
+        const auto event = group.events.at(i).toMap();
+        QVariantMap result{
+            {"index", group.indexes.at(i)},
+            {"eventId", event.value("eventId")},
+        };
+
+        if (!group.session)
+        {
+            result.insert("error", "unknown session");
+            results.append(result);
+            continue;
+        }
+
+        // libolm decodes the base64 message in place
+        auto message = event.value("ciphertext").toString().toUtf8();
+        auto buffer = message;
+        const auto maxLength = olm_group_decrypt_max_plaintext_length(group.session->session,
+            reinterpret_cast<uint8_t*>(buffer.data()), std::size_t(buffer.size()));
+        if (maxLength == olm_error())
+        {
+            result.insert("error", olm_inbound_group_session_last_error(group.session->session));
+            results.append(result);
+            continue;
+        }
+
+        QByteArray plaintext(qsizetype(maxLength), Qt::Uninitialized);
+        uint32_t messageIndex = 0;
+        const auto length = olm_group_decrypt(group.session->session,
+            reinterpret_cast<uint8_t*>(message.data()), std::size_t(message.size()),
+            reinterpret_cast<uint8_t*>(plaintext.data()), maxLength, &messageIndex);
+        if (length == olm_error())
+        {
+            result.insert("error", olm_inbound_group_session_last_error(group.session->session));
+            results.append(result);
+            continue;
+        }
+
+        plaintext.truncate(qsizetype(length));
+        result.insert("plaintext", QString::fromUtf8(plaintext));
+        result.insert("messageIndex", messageIndex);
+        results.append(result);
+    }
+
+    return results;
+}
+
+const QVariantList NativeCrypto::merge(const QList<QVariantList> &results, qsizetype count)
+{
+    // restore the order of the events across all groups
+    QVariantList merged(count);
+    for (auto&& group : results)
+    {
+        for (auto&& result : group)
+        {
+            auto map = result.toMap();
+            const auto index = map.take("index").toLongLong();
+            merged[index] = map;
+        }
+    }
+    return merged;
+}
+
+#endif
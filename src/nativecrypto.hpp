@@ -0,0 +1,81 @@
+#pragma once
+
+#ifdef NATIVE_CRYPTO_ENABLED
+
+#include <QObject>
+#include <QString>
+#include <QVariant>
+#include <QThreadPool>
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * Native megolm decryption backed by libolm, exposed to element-web over
+ * QWebChannel as window.qelementCrypto (see assets/scripts/native-crypto.js).
+ *
+ * Batches are split by megolm session and decrypted on a thread pool,
+ * events of the same session are decrypted sequentially because libolm
+ * advances the ratchet of the session. Sessions are only kept in memory,
+ * element-web stays the owner of all keys. Events which can't be decrypted
+ * natively are returned with an error, the page falls back to the WASM
+ * implementation for them.
+ */
+class NativeCrypto : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * threads is the size of the thread pool, 0 uses the number of cores.
+     */
+    explicit NativeCrypto(int threads = 0, QObject *parent = nullptr);
+    ~NativeCrypto();
+
+    static const QString channelName()
+    {
+        return "qelementCrypto";
+    }
+
+    /**
+     * Imports a megolm inbound session. key is the session key of a
+     * m.room_key event, or an exported session key of a forwarded key
+     * or the key backup when exported is true.
+     */
+    Q_INVOKABLE bool importSession(const QString &sessionId, const QString &key, bool exported);
+    Q_INVOKABLE bool hasSession(const QString &sessionId) const;
+
+    /**
+     * Decrypts a list of {eventId, sessionId, ciphertext} objects on the
+     * thread pool and returns the id of the batch. The results are
+     * delivered with batchDecrypted in the order of the events.
+     */
+    Q_INVOKABLE int decryptBatch(const QVariantList &events);
+
+    /**
+     * Decrypts a list of events on the thread pool and waits for the results.
+     */
+    const QVariantList decrypt(const QVariantList &events);
+
+signals:
+    /**
+     * Results are {eventId, plaintext, messageIndex} or {eventId, error} objects.
+     */
+    void batchDecrypted(int batchId, const QVariantList &results);
+
+private:
+    struct Session;
+    struct Group;
+
+    const QList<Group> groupBySession(const QVariantList &events) const;
+    static const QVariantList decryptGroup(const Group &group);
+    static const QVariantList merge(const QList<QVariantList> &results, qsizetype count);
+
+    mutable std::mutex mutex;
+    std::unordered_map<QString, std::shared_ptr<Session>> sessions;
+    int nextBatchId = 1;
+    QThreadPool pool;
+};
+
+#endif
@@ -0,0 +1,228 @@
+#include "networkmonitor.hpp"
+
+#include <QStringList>
+#include <QCryptographicHash>
+#include <QRandomGenerator>
+#include <QDateTime>
+#include <QTimer>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// identical requests within one interval before they are reported
+constexpr const int repeatThreshold = 5;
+
+// requests to one endpoint within one interval before it is checked for polling
+constexpr const int pollingThreshold = 6;
+
+// maximum coefficient of variation of the request intervals of a polling loop
+constexpr const double pollingVariation = 0.25;
+
+// bound the memory of pages generating unique urls
+constexpr const int maxPatterns = 10000;
+constexpr const int maxIntervals = 32;
+
+// number of hosts and patterns in the summary
+constexpr const int summaryLimit = 10;
+
+NetworkMonitor::NetworkMonitor(const QString &profileName, int interval, QWebEngineUrlRequestInterceptor *next, QObject *parent)
+    : QWebEngineUrlRequestInterceptor(parent)
+{
+    this->profileName = profileName;
+    this->next = next;
+    this->intervalStart = QDateTime::currentMSecsSinceEpoch();
+
+    // hashes of queries can't be compared across runs or guessed from common values
+    this->querySalt = QByteArray::number(QRandomGenerator::system()->generate64(), 16);
+
+    this->timer = std::make_unique<QTimer>();
+    this->timer->setInterval(std::max(1, interval) * 1000);
+    connect(this->timer.get(), &QTimer::timeout, this, &NetworkMonitor::summarize);
+    this->timer->start();
+}
+
+NetworkMonitor::~NetworkMonitor()
+{
+    this->timer->stop();
+}
+
+void NetworkMonitor::interceptRequest(QWebEngineUrlRequestInfo &info)
+{
+    // Qt 6 calls interceptors on the ui thread, no locking required
+    const auto now = QDateTime::currentMSecsSinceEpoch();
+    const auto url = info.requestUrl();
+    const auto host = NetworkMonitor::hostName(url);
+    const auto method = QString::fromLatin1(info.requestMethod());
+
+    ++this->types[NetworkMonitor::resourceTypeName(info.resourceType())].requests;
+    ++this->hosts[host].requests;
+
+    if (host == NetworkMonitor::hostName(info.firstPartyUrl()))
+    {
+        ++this->firstParty;
+    }
+    else
+    {
+        ++this->thirdParty;
+    }
+
+    // queries carry tokens and filters which must not end up in the log, identical
+    // requests are told apart by a hash of the query instead
+    const auto endpoint = QString("%1 %2").arg(method, url.toString(QUrl::RemoveQuery | QUrl::RemoveFragment));
+    const auto request = url.hasQuery() ? QString("%1 (query %2)").arg(endpoint, this->queryHash(url)) : endpoint;
+    NetworkMonitor::track(this->requests, request, now);
+    NetworkMonitor::track(this->endpoints, endpoint, now);
+
+    if (this->next)
+    {
+        this->next->interceptRequest(info);
+    }
+}
+
+void NetworkMonitor::addResponse(const QUrl &url, qint64 bytes)
+{
+    this->hosts[NetworkMonitor::hostName(url)].bytes += bytes;
+}
+
+void NetworkMonitor::summarize()
+{
+    const auto now = QDateTime::currentMSecsSinceEpoch();
+    const auto total = this->firstParty + this->thirdParty;
+
+    if (total > 0)
+    {
+        qInfo().noquote() << QString("network [%1]: %2 requests in %3s, %4 first-party, %5 third-party").arg(
+            this->profileName, QString::number(total), QString::number((now - this->intervalStart) / 1000),
+            QString::number(this->firstParty), QString::number(this->thirdParty));
+
+        QStringList types;
+        for (auto it = this->types.cbegin(); it != this->types.cend(); ++it)
+        {
+            types.append(QString("%1=%2").arg(it.key(), QString::number(it.value().requests)));
+        }
+        qInfo().noquote() << QString("network [%1]:   types: %2").arg(this->profileName, types.join(", "));
+
+        std::vector<std::pair<QString, Counter>> hosts;
+        for (auto it = this->hosts.cbegin(); it != this->hosts.cend(); ++it)
+        {
+            hosts.emplace_back(it.key(), it.value());
+        }
+        std::sort(hosts.begin(), hosts.end(), [](auto&& a, auto&& b){
+            return a.second.requests > b.second.requests;
+        });
+        hosts.resize(std::min<size_t>(hosts.size(), summaryLimit));
+        for (auto&& [host, counter] : hosts)
+        {
+            qInfo().noquote() << QString("network [%1]:   host %2: %3 requests%4").arg(this->profileName, host,
+                QString::number(counter.requests), counter.bytes > 0 ? QString(", %1 bytes").arg(counter.bytes) : QString());
+        }
+    }
+
+    // repeated identical requests
+    auto reported = 0;
+    for (auto it = this->requests.cbegin(); it != this->requests.cend() && reported < summaryLimit; ++it)
+    {
+        if (it.value().count >= repeatThreshold)
+        {
+            qWarning().noquote() << QString("network [%1]: repeated request: %2 (%3 times)").arg(
+                this->profileName, it.key(), QString::number(it.value().count));
+            ++reported;
+        }
+    }
+
+    // polling loops hit the same endpoint in a regular interval
+    reported = 0;
+    for (auto it = this->endpoints.cbegin(); it != this->endpoints.cend() && reported < summaryLimit; ++it)
+    {
+        const auto &intervals = it.value().intervals;
+        if (it.value().count < pollingThreshold || intervals.isEmpty())
+        {
+            continue;
+        }
+
+        double mean = 0;
+        for (auto&& interval : intervals)
+        {
+            mean += interval;
+        }
+        mean /= intervals.size();
+
+        double variance = 0;
+        for (auto&& interval : intervals)
+        {
+            variance += (interval - mean) * (interval - mean);
+        }
+        variance /= intervals.size();
+
+        if (mean > 0 && std::sqrt(variance) / mean <= pollingVariation)
+        {
+            qWarning().noquote() << QString("network [%1]: polling loop: %2 every %3ms (%4 times)").arg(
+                this->profileName, it.key(), QString::number(qint64(mean)), QString::number(it.value().count));
+            ++reported;
+        }
+    }
+
+    this->intervalStart = now;
+    this->firstParty = 0;
+    this->thirdParty = 0;
+    this->types.clear();
+    this->hosts.clear();
+    this->requests.clear();
+    this->endpoints.clear();
+}
+
+const QString NetworkMonitor::resourceTypeName(QWebEngineUrlRequestInfo::ResourceType type)
+{
+    switch (type)
+    {
+        case QWebEngineUrlRequestInfo::ResourceTypeMainFrame:     return "document";
+        case QWebEngineUrlRequestInfo::ResourceTypeSubFrame:      return "frame";
+        case QWebEngineUrlRequestInfo::ResourceTypeStylesheet:    return "stylesheet";
+        case QWebEngineUrlRequestInfo::ResourceTypeScript:        return "script";
+        case QWebEngineUrlRequestInfo::ResourceTypeImage:         return "image";
+        case QWebEngineUrlRequestInfo::ResourceTypeFontResource:  return "font";
+        case QWebEngineUrlRequestInfo::ResourceTypeMedia:         return "media";
+        case QWebEngineUrlRequestInfo::ResourceTypeWorker:
+        case QWebEngineUrlRequestInfo::ResourceTypeSharedWorker:
+        case QWebEngineUrlRequestInfo::ResourceTypeServiceWorker: return "worker";
+        case QWebEngineUrlRequestInfo::ResourceTypeFavicon:       return "favicon";
+        case QWebEngineUrlRequestInfo::ResourceTypeXhr:           return "xhr";
+        case QWebEngineUrlRequestInfo::ResourceTypePing:          return "ping";
+        default:                                                  return "other";
+    }
+}
+
+const QString NetworkMonitor::hostName(const QUrl &url)
+{
+    // custom schemes like element:// have no host
+    return url.host().isEmpty() ? url.scheme() : url.host();
+}
+
+const QString NetworkMonitor::queryHash(const QUrl &url) const
+{
+    const auto hash = QCryptographicHash::hash(this->querySalt + url.query(QUrl::FullyEncoded).toUtf8(), QCryptographicHash::Sha256);
+    return QString::fromLatin1(hash.toHex().left(8));
+}
+
+void NetworkMonitor::track(QHash<QString, Pattern> &patterns, const QString &key, qint64 now)
+{
+    auto it = patterns.find(key);
+    if (it == patterns.end())
+    {
+        if (patterns.size() >= maxPatterns)
+        {
+            return;
+        }
+        it = patterns.insert(key, {});
+    }
+
+    auto &pattern = it.value();
+    if (pattern.count > 0 && pattern.intervals.size() < maxIntervals)
+    {
+        pattern.intervals.append(now - pattern.last);
+    }
+    pattern.last = now;
+    ++pattern.count;
+}
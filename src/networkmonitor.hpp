@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QWebEngineUrlRequestInterceptor>
+#include <QWebEngineUrlRequestInfo>
+#include <QHash>
+#include <QMap>
+#include <QList>
+
+#include <memory>
+
+class QTimer;
+
+/**
+ * Counts the requests of the page per resource type, host and first-party
+ * status and logs a summary in a fixed interval.
+ *
+ * Repeated identical requests and requests to the same endpoint in a
+ * regular interval (polling loops) are flagged in the summary. Queries are
+ * never logged, identical requests are matched by a salted hash of the query.
+ * Interceptors only see the request, so bytes are only known for responses
+ * reported with addResponse(). Another interceptor can be chained, because
+ * a profile can only have one.
+ */
+class NetworkMonitor : public QWebEngineUrlRequestInterceptor
+{
+    Q_OBJECT
+
+public:
+    explicit NetworkMonitor(const QString &profileName, int interval, QWebEngineUrlRequestInterceptor *next = nullptr, QObject *parent = nullptr);
+    ~NetworkMonitor();
+
+    void interceptRequest(QWebEngineUrlRequestInfo &info) override;
+
+    /**
+     * Adds the size of a response to the statistics of its host.
+     */
+    void addResponse(const QUrl &url, qint64 bytes);
+
+    /**
+     * Logs the statistics of the current interval and starts a new one.
+     */
+    void summarize();
+
+private:
+    struct Counter
+    {
+        quint64 requests = 0;
+        qint64 bytes = 0;
+    };
+
+    struct Pattern
+    {
+        int count = 0;
+        qint64 last = 0;
+        QList<qint64> intervals; // ms between requests
+    };
+
+    static const QString resourceTypeName(QWebEngineUrlRequestInfo::ResourceType type);
+    static const QString hostName(const QUrl &url);
+    static void track(QHash<QString, Pattern> &patterns, const QString &key, qint64 now);
+    const QString queryHash(const QUrl &url) const;
+
+    QString profileName;
+    QWebEngineUrlRequestInterceptor *next;
+    QByteArray querySalt;
+    std::unique_ptr<QTimer> timer;
+
+    qint64 intervalStart;
+    quint64 firstParty = 0;
+    quint64 thirdParty = 0;
+    QMap<QString, Counter> types;
+    QHash<QString, Counter> hosts;
+    QHash<QString, Pattern> requests;  // method, url without query and a hash of the query
+    QHash<QString, Pattern> endpoints; // method and url without query
+};
@@ -5,8 +5,10 @@
 
 std::unique_ptr<Paths> Paths::_defaultInstance;
 
-Paths::Paths(const QString &prefix)
+Paths::Paths(const QString &prefix, bool create)
 {
+    this->_create = create;
+
     if (prefix.isEmpty())
     {
         this->_baseLocation = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
@@ -17,7 +19,7 @@ Paths::Paths(const QString &prefix)
     }
 
     QDir root = QDir(this->_baseLocation);
-    this->_valid = root.mkpath(".");
+    this->_valid = create ? root.mkpath(".") : root.exists();
 }
 
 Paths *Paths::defaultInstance()
@@ -49,6 +51,12 @@ const QString Paths::webEngineProfilePath(const QString &profile, bool real) con
         return {};
     }
 
+    const auto cached = this->_profilePaths.constFind(profile);
+    if (cached != this->_profilePaths.constEnd())
+    {
+        return cached.value();
+    }
+
     const QString _profile = profile.isEmpty() ? "-default" : "-" + profile;
 
     const auto location = QString("%1/%2").arg(this->_baseLocation,
@@ -59,7 +67,11 @@ const QString Paths::webEngineProfilePath(const QString &profile, bool real) con
 #endif
     );
 
-    const bool success = QDir(location).mkpath(".");
+    const bool success = this->_create ? QDir(location).mkpath(".") : QDir(location).exists();
+    if (success)
+    {
+        this->_profilePaths.insert(profile, location);
+    }
 
     if (real)
     {
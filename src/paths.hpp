@@ -3,6 +3,7 @@
 #include <memory>
 
 #include <QString>
+#include <QHash>
 
 class Paths
 {
@@ -11,8 +12,10 @@ public:
      * Constructs a paths object with the given prefix.
      * Leave empty to use the default prefix which is
      * QStandardPaths::writableLocation(QStandardPaths::AppDataLocation).
+     * Without create no directories are created and only
+     * existing profiles have a path.
      */
-    Paths(const QString &prefix = {});
+    Paths(const QString &prefix = {}, bool create = true);
 
     /**
      * Returns a constructed default instance for standard usage.
@@ -26,6 +29,7 @@ public:
 
     /**
      * QtWebEngine profile path for persistent storage.
+     * The directory is created on the first call per profile.
      */
     const QString webEngineProfilePath(const QString &profile = {}, bool real = true) const;
 
@@ -34,4 +38,8 @@ private:
     QString _empty;
     QString _baseLocation;
     bool _valid = false;
+    bool _create = true;
+
+    // profile paths which were created successfully
+    mutable QHash<QString, QString> _profilePaths;
 };
@@ -0,0 +1,156 @@
+#include "pgotraining.hpp"
+#include "elementurlscheme.hpp"
+#include "desktopnotification.hpp"
+#include "configmanager.hpp"
+#include "engineoptions.hpp"
+
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QPainter>
+#include <QImage>
+#include <QFile>
+#include <QDir>
+#include <QUrl>
+
+#include <functional>
+
+// urls requested by element-web during startup
+static const QStringList requestPaths = {
+    "/",
+    "/index.html",
+    "/config.json?cachebuster=1700000000000",
+    "/bundles/0123456789abcdef/bundle.js",
+    "/bundles/0123456789abcdef/vendors~init.js",
+    "/bundles/0123456789abcdef/theme-light.css",
+    "/bundles/0123456789abcdef/olm.wasm",
+    "/i18n/languages.json",
+    "/i18n/en_EN.json",
+    "/fonts/Inter/Inter-Regular.woff2",
+    "/img/element-desktop-logo.svg",
+    "/vector-icons/favicon.ico",
+};
+
+static void writeFile(const QString &path, const QByteArray &data)
+{
+    QDir().mkpath(path.section('/', 0, -2));
+    QFile file(path);
+    if (file.open(QIODevice::WriteOnly))
+    {
+        file.write(data);
+    }
+}
+
+PgoTraining::PgoTraining(int iterations)
+{
+    this->iterations = iterations;
+}
+
+const QJsonObject PgoTraining::run()
+{
+    QTemporaryDir temporary;
+    if (!temporary.isValid())
+    {
+        return {{"error", temporary.errorString()}};
+    }
+
+    const auto measure = [this](const std::function<void()> &section) {
+        QElapsedTimer timer;
+        timer.start();
+        section();
+        return QJsonObject{
+            {"iterations", this->iterations},
+            {"usPerIteration", double(timer.nsecsElapsed()) / 1e3 / this->iterations},
+        };
+    };
+
+    return {
+        {"urlScheme", measure([&]{ this->trainUrlScheme(temporary.filePath("webapp")); })},
+        {"notifications", measure([&]{ this->trainNotifications(); })},
+        {"config", measure([&]{ this->trainConfig(temporary.filePath("profile")); })},
+    };
+}
+
+void PgoTraining::trainUrlScheme(const QString &webroot)
+{
+    // a webroot shaped like element-web
+    writeFile(webroot + "/index.html",
+        "<!DOCTYPE html><html lang=\"en\"><head><meta charset=\"utf-8\"><title>Element</title>"
+        "<link rel=\"icon\" href=\"vector-icons/favicon.ico\">"
+        "<link href=\"bundles/0123456789abcdef/theme-light.css\" rel=\"stylesheet\">"
+        "</head><body><noscript>JavaScript is required</noscript><section id=\"matrixchat\"></section>"
+        "<script src=\"bundles/0123456789abcdef/vendors~init.js\"></script>"
+        "<script src=\"bundles/0123456789abcdef/bundle.js\"></script></body></html>");
+    writeFile(webroot + "/config.json",
+        R"({"default_server_config": {"m.homeserver": {"base_url": "https://matrix-client.matrix.org", "server_name": "matrix.org"}},)"
+        R"( "brand": "Element", "disable_guests": true, "default_theme": "light", "room_directory": {"servers": ["matrix.org"]}})");
+
+    ElementUrlScheme handler(webroot);
+    handler.setPreloadHintsFile(webroot + "/PreloadHints");
+
+    for (auto i = 0; i < this->iterations; ++i)
+    {
+        for (auto&& path : requestPaths)
+        {
+            const auto file = ElementUrlScheme::getFilePath(QUrl("element://localhost" + path));
+            ElementUrlScheme::mimeType(QString("%1/%2").arg(webroot, file));
+            ElementUrlScheme::preloadLink(file, i % 2);
+            if (handler.learning)
+            {
+                handler.learn(file);
+            }
+        }
+
+        // every revision transforms index.html again
+        handler.indexRevision.clear();
+        handler.indexPage("localhost");
+
+        if (handler.learning)
+        {
+            handler.finishLearning(handler.revision("localhost"));
+        }
+    }
+}
+
+void PgoTraining::trainNotifications()
+{
+    QImage icon(96, 96, QImage::Format_ARGB32_Premultiplied);
+    icon.fill(Qt::transparent);
+    QPainter painter(&icon);
+    painter.setBrush(QColor(13, 189, 139));
+    painter.drawEllipse(icon.rect().adjusted(4, 4, -4, -4));
+    painter.end();
+
+    // notifications are prepared but never shown
+    for (auto i = 0; i < this->iterations; ++i)
+    {
+        DesktopNotification notification(QString("Room %1").arg(i % 10), QString("Message number %1 from the training").arg(i), icon);
+        notification.setMessage(QString("Edited message number %1").arg(i));
+        notification.setImage(icon.scaled(64, 64));
+    }
+}
+
+void PgoTraining::trainConfig(const QString &directory)
+{
+    QDir().mkpath(directory);
+
+    for (auto i = 0; i < this->iterations; ++i)
+    {
+        // reading the preferences and translating the engine options happens on every start
+        ConfigManager config(directory);
+        const EngineOptions engineOptions(&config);
+        engineOptions.arguments();
+
+        for (auto j = 0; j < 100; ++j)
+        {
+            config.snapshot();
+            config.webroot();
+            config.downloadsMaxConcurrent();
+            config.mediaCacheEnabled();
+            config.cacheType();
+            config.diagnosticsStallThreshold();
+            config.searchEventIndexEnabled();
+        }
+
+        config.setDownloadsLastDirectory(QString("/tmp/downloads/%1").arg(i % 4));
+    }
+}
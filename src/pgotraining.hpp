@@ -0,0 +1,26 @@
+#pragma once
+
+#include <QJsonObject>
+
+/**
+ * Headless workload for the profile guided optimization build. Runs the
+ * hot paths of QElement which don't need QtWebEngine: the element:// url
+ * scheme handler, the notification path and the preferences.
+ *
+ * The same workload measures the result, every section reports its time
+ * per iteration in microseconds.
+ */
+class PgoTraining
+{
+public:
+    explicit PgoTraining(int iterations);
+
+    const QJsonObject run();
+
+private:
+    void trainUrlScheme(const QString &webroot);
+    void trainNotifications();
+    void trainConfig(const QString &directory);
+
+    int iterations;
+};
@@ -0,0 +1,142 @@
+#include "profile.hpp"
+#include "globals.hpp"
+#include "configmanager.hpp"
+#include "engineoptions.hpp"
+#include "elementurlscheme.hpp"
+#include "browserwindow.hpp"
+#include "instanceserver.hpp"
+#include "mediacache.hpp"
+#include "networkmonitor.hpp"
+#include "httpcache.hpp"
+
+#include <QApplication>
+#include <QWebEngineProfile>
+
+#include <algorithm>
+
+Profile::Profile(const QString &name, std::unique_ptr<ConfigManager> config, const QString &webroot, QObject *parent)
+    : QObject(parent),
+      _name(name),
+      _config(std::move(config))
+{
+    // check if an alternative webroot was requested
+    auto webappRoot = this->_config->webroot();
+    if (!webroot.isEmpty())
+    {
+        qDebug() << "using alternative webroot:" << webroot;
+        webappRoot = webroot;
+    }
+
+    // register element:// url scheme
+    this->_urlScheme = std::make_unique<ElementUrlScheme>(webappRoot);
+    this->_urlScheme->setOptimizeIndex(this->_config->optimizeIndex());
+    this->_urlScheme->setPreloadHintsFile(QString("%1/%2").arg(paths->webEngineProfilePath(this->_name), "PreloadHints"));
+    this->_webEngineProfile = std::make_unique<QWebEngineProfile>(name);
+    this->_webEngineProfile->installUrlSchemeHandler(ElementUrlScheme::schemeName(), this->_urlScheme.get());
+    this->setupWebEngineProfile();
+
+    // persistent cache for matrix media
+    if (this->_config->mediaCacheEnabled())
+    {
+        const auto directory = QString("%1/%2").arg(paths->webEngineProfilePath(this->_name), "MediaCache");
+        const auto maxSize = qint64(std::max(1, this->_config->mediaCacheSize())) * 1024 * 1024;
+        this->_mediaCache = std::make_unique<MediaCache>(directory, maxSize);
+        this->_mediaCacheInterceptor = std::make_unique<MediaCacheInterceptor>(this->_mediaCache.get());
+        this->_webEngineProfile->installUrlSchemeHandler(MediaCache::schemeName(), this->_mediaCache.get());
+    }
+
+    // a profile has only one interceptor, the network monitor forwards to the media cache
+    if (this->_config->networkMonitorEnabled())
+    {
+        this->_networkMonitor = std::make_unique<NetworkMonitor>(this->_name, this->_config->networkMonitorInterval(), this->_mediaCacheInterceptor.get());
+        this->_webEngineProfile->setUrlRequestInterceptor(this->_networkMonitor.get());
+
+        if (this->_mediaCache)
+        {
+            connect(this->_mediaCache.get(), &MediaCache::served, this->_networkMonitor.get(), &NetworkMonitor::addResponse);
+        }
+    }
+    else if (this->_mediaCacheInterceptor)
+    {
+        this->_webEngineProfile->setUrlRequestInterceptor(this->_mediaCacheInterceptor.get());
+    }
+
+    connect(this->_config.get(), &ConfigManager::configUpdated, this, [&](const ConfigManager::Key &key){
+        if (key == ConfigManager::Key::Webroot)
+        {
+            qDebug() << "webroot of profile" << this->_name << "updated to:" << this->_config->webroot();
+            this->_urlScheme->changeRoot(this->_config->webroot());
+        }
+        else if (key == ConfigManager::Key::OptimizeIndex)
+        {
+            this->_urlScheme->setOptimizeIndex(this->_config->optimizeIndex());
+        }
+    });
+}
+
+Profile::~Profile()
+{
+    // all pages must be deleted before their profile
+    this->_instanceServer.reset();
+    this->_window.reset();
+    this->_webEngineProfile.reset();
+
+    // the cache is written back on exit once QtWebEngine has shut down
+    this->_httpCache.reset();
+}
+
+void Profile::setupWebEngineProfile()
+{
+    const auto path = paths->webEngineProfilePath(this->_name);
+    this->_webEngineProfile->setPersistentStoragePath(QString("%1/%2").arg(path, "Storage"));
+    this->_webEngineProfile->setPersistentCookiesPolicy(QWebEngineProfile::AllowPersistentCookies);
+
+    // the Chromium switches are process wide and taken from the first profile,
+    // but the cache type, location and size can differ per profile
+    const EngineOptions engineOptions(this->_config.get());
+    this->_httpCache = std::make_unique<HttpCache>(this->_name, this->_config.get());
+    this->_httpCache->apply(this->_webEngineProfile.get(), engineOptions.httpCacheSize());
+
+    // add application to user agent
+    auto useragent = this->_webEngineProfile->httpUserAgent();
+    useragent.append(QString(" %1/%2").arg(qApp->applicationName(), qApp->applicationVersion()));
+    this->_webEngineProfile->setHttpUserAgent(useragent);
+}
+
+const QString &Profile::name() const
+{
+    return this->_name;
+}
+
+ConfigManager *Profile::config() const
+{
+    return this->_config.get();
+}
+
+ElementUrlScheme *Profile::urlScheme() const
+{
+    return this->_urlScheme.get();
+}
+
+QWebEngineProfile *Profile::webEngineProfile() const
+{
+    return this->_webEngineProfile.get();
+}
+
+BrowserWindow *Profile::window()
+{
+    if (!this->_window)
+    {
+        this->_window = std::make_unique<BrowserWindow>(this->_name, this->_webEngineProfile.get(), this->_config.get());
+
+        this->_instanceServer = std::make_unique<InstanceServer>(this->_name);
+        connect(this->_instanceServer.get(), &InstanceServer::showRequested, this->_window.get(), &BrowserWindow::activate);
+        connect(this->_instanceServer.get(), &InstanceServer::openRequested, this->_window.get(), &BrowserWindow::openUrl);
+        this->_instanceServer->listen();
+
+        // the page keeps its web app version until the user reloads
+        connect(this->_urlScheme.get(), &ElementUrlScheme::upgradeReady, this->_window.get(), &BrowserWindow::offerReload);
+    }
+
+    return this->_window.get();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+#include <memory>
+
+class QWebEngineProfile;
+class ConfigManager;
+class ElementUrlScheme;
+class BrowserWindow;
+class InstanceServer;
+class MediaCache;
+class MediaCacheInterceptor;
+class NetworkMonitor;
+class HttpCache;
+
+/**
+ * A named QElement profile. Owns the preferences, the element:// url
+ * scheme handler, the QtWebEngine profile and the browser window.
+ * Multiple profiles can be hosted in one process and share the engine.
+ */
+class Profile : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * Creates the QtWebEngine profile. The config manager is created by the
+     * caller, because the preferences are required before QApplication exists.
+     * An empty webroot uses the webroot from the preferences.
+     */
+    Profile(const QString &name, std::unique_ptr<ConfigManager> config, const QString &webroot = {}, QObject *parent = nullptr);
+    ~Profile();
+
+    const QString &name() const;
+    ConfigManager *config() const;
+    ElementUrlScheme *urlScheme() const;
+    QWebEngineProfile *webEngineProfile() const;
+
+    /**
+     * Creates the browser window of this profile on first call
+     * and starts listening for activation requests of other launches.
+     */
+    BrowserWindow *window();
+
+private:
+    void setupWebEngineProfile();
+
+    QString _name;
+    std::unique_ptr<ConfigManager> _config;
+    std::unique_ptr<ElementUrlScheme> _urlScheme;
+    std::unique_ptr<MediaCache> _mediaCache;
+    std::unique_ptr<MediaCacheInterceptor> _mediaCacheInterceptor;
+    std::unique_ptr<NetworkMonitor> _networkMonitor;
+    std::unique_ptr<HttpCache> _httpCache;
+    std::unique_ptr<QWebEngineProfile> _webEngineProfile;
+    std::unique_ptr<BrowserWindow> _window;
+    std::unique_ptr<InstanceServer> _instanceServer;
+};
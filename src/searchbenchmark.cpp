@@ -0,0 +1,222 @@
+#include "searchbenchmark.hpp"
+#include "eventindex.hpp"
+
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QSet>
+#include <QDebug>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+// shape of the generated corpus
+constexpr const int vocabularySize = 20000;
+constexpr const int roomCount = 200;
+constexpr const int senderCount = 50;
+
+// events per transaction, the same as the live event batches
+constexpr const int batchSize = 500;
+
+// searches per kind of query
+constexpr const int queryCount = 100;
+
+// reproducible pseudo words from syllables, the index of a word is its Zipf rank
+static const QStringList vocabulary(QRandomGenerator &random)
+{
+    static const QStringList syllables = {
+        "ka", "lo", "mi", "ne", "ru", "ta", "shi", "po", "ve", "da",
+        "zu", "fe", "gri", "bo", "sa", "tel", "mon", "ar", "qu", "ix",
+    };
+
+    QStringList words;
+    QSet<QString> seen;
+    while (words.size() < vocabularySize)
+    {
+        QString word;
+        const auto length = 1 + int(random.bounded(4));
+        for (auto i = 0; i < length; ++i)
+        {
+            word += syllables.at(int(random.bounded(qsizetype(syllables.size()))));
+        }
+        if (!seen.contains(word))
+        {
+            seen.insert(word);
+            words.append(word);
+        }
+    }
+    return words;
+}
+
+static double percentile(std::vector<double> values, double p)
+{
+    if (values.empty())
+    {
+        return -1;
+    }
+
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, std::size_t(p * double(values.size())))];
+}
+
+static qint64 peakRss()
+{
+#ifdef Q_OS_UNIX
+    struct rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+    return qint64(usage.ru_maxrss) * 1024;
+#else
+    return -1;
+#endif
+}
+
+SearchBenchmark::SearchBenchmark(const QString &directory, int events)
+{
+    this->directory = directory;
+    this->events = events;
+}
+
+const QJsonObject SearchBenchmark::run()
+{
+    QTemporaryDir temporary(QString("%1/qelement-search-benchmark-XXXXXX").arg(this->directory));
+    if (!temporary.isValid())
+    {
+        return {{"error", temporary.errorString()}};
+    }
+
+    EventIndexDatabase database(temporary.path());
+    if (!database.open())
+    {
+        return {{"error", database.lastError()}};
+    }
+
+    QRandomGenerator random(42);
+    const auto words = vocabulary(random);
+
+    std::vector<double> cumulative(words.size());
+    double sum = 0;
+    for (std::size_t i = 0; i < cumulative.size(); ++i)
+    {
+        sum += 1.0 / double(i + 1);
+        cumulative[i] = sum;
+    }
+    const auto word = [&]{
+        const auto value = random.generateDouble() * sum;
+        return words.at(qsizetype(std::upper_bound(cumulative.begin(), cumulative.end(), value) - cumulative.begin()));
+    };
+
+    // index the corpus in batches, the generation is excluded from the time
+    qint64 indexNanoseconds = 0;
+    auto timestamp = qint64(1600000000000);
+    QElapsedTimer timer;
+    for (auto offset = 0; offset < this->events; offset += batchSize)
+    {
+        QVariantList batch;
+        for (auto i = offset; i < std::min(this->events, offset + batchSize); ++i)
+        {
+            QStringList body;
+            const auto length = 4 + int(random.bounded(20));
+            for (auto j = 0; j < length; ++j)
+            {
+                body.append(word());
+            }
+
+            const auto sender = QString("@user%1:localhost").arg(random.bounded(senderCount));
+            timestamp += 1 + random.bounded(60000);
+            batch.append(QVariantMap{
+                {"event", QVariantMap{
+                    {"event_id", QString("$event%1").arg(i)},
+                    {"room_id", QString("!room%1:localhost").arg(random.bounded(roomCount))},
+                    {"sender", sender},
+                    {"origin_server_ts", timestamp},
+                    {"type", "m.room.message"},
+                    {"content", QVariantMap{
+                        {"msgtype", "m.text"},
+                        {"body", body.join(' ')},
+                    }},
+                }},
+                {"profile", QVariantMap{
+                    {"displayname", sender.mid(1, sender.indexOf(':') - 1)},
+                }},
+            });
+        }
+
+        timer.start();
+        if (database.addEvents(batch) < 0)
+        {
+            return {{"error", database.lastError()}};
+        }
+        indexNanoseconds += timer.nsecsElapsed();
+
+        if ((offset / batchSize) % 200 == 0)
+        {
+            qDebug() << "search benchmark: indexed" << offset << "events";
+        }
+    }
+
+    const auto indexMs = double(indexNanoseconds) / 1e6;
+    const auto stats = database.stats();
+
+    // frequent, rare and combined words, with and without room filter and ordered by recency
+    struct Kind
+    {
+        QString name;
+        std::function<QVariantMap()> args;
+    };
+    const auto term = [&](int minRank, int maxRank) {
+        return words.at(minRank + int(random.bounded(maxRank - minRank)));
+    };
+    const QList<Kind> kinds = {
+        {"frequent", [&]{ return QVariantMap{{"search_term", term(10, 100)}}; }},
+        {"rare", [&]{ return QVariantMap{{"search_term", term(5000, vocabularySize)}}; }},
+        {"twoWords", [&]{ return QVariantMap{{"search_term", term(10, 1000) + " " + term(10, 1000)}}; }},
+        {"room", [&]{ return QVariantMap{
+            {"search_term", term(10, 1000)},
+            {"room_id", QString("!room%1:localhost").arg(random.bounded(roomCount))},
+        }; }},
+        {"recent", [&]{ return QVariantMap{{"search_term", term(10, 1000)}, {"order_by_recency", true}}; }},
+    };
+
+    QJsonObject queries;
+    for (auto&& kind : kinds)
+    {
+        std::vector<double> latencies;
+        qint64 results = 0;
+        for (auto i = 0; i < queryCount; ++i)
+        {
+            auto args = kind.args();
+            args.insert("limit", 10);
+            args.insert("before_limit", 1);
+            args.insert("after_limit", 1);
+
+            timer.start();
+            const auto response = database.search(args);
+            latencies.push_back(double(timer.nsecsElapsed()) / 1e6);
+            results += response.value("count").toLongLong();
+        }
+
+        queries.insert(kind.name, QJsonObject{
+            {"p50", percentile(latencies, 0.5)},
+            {"p95", percentile(latencies, 0.95)},
+            {"p99", percentile(latencies, 0.99)},
+            {"max", percentile(latencies, 1.0)},
+            {"averageCount", double(results) / queryCount},
+        });
+    }
+
+    return {
+        {"events", this->events},
+        {"rooms", roomCount},
+        {"indexMs", indexMs},
+        {"eventsPerSecond", indexMs > 0 ? double(this->events) / indexMs * 1000 : 0},
+        {"indexedEvents", stats.value("eventCount").toLongLong()},
+        {"bytes", stats.value("size").toLongLong()},
+        {"peakRss", peakRss()},
+        {"queries", queries},
+    };
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <QString>
+#include <QJsonObject>
+
+/**
+ * Indexes a generated corpus of chat messages with the event index and
+ * measures the indexing throughput and the latency of typical searches.
+ *
+ * The corpus is reproducible, the words follow a Zipf distribution like
+ * natural language. All timings are in milliseconds.
+ */
+class SearchBenchmark
+{
+public:
+    /**
+     * The index is created in a temporary directory inside of directory.
+     */
+    SearchBenchmark(const QString &directory, int events);
+
+    const QJsonObject run();
+
+private:
+    QString directory;
+    int events;
+};
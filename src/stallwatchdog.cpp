@@ -0,0 +1,229 @@
+#include "stallwatchdog.hpp"
+
+#include <QDateTime>
+#include <QFile>
+#include <QDebug>
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+#if defined(Q_OS_LINUX) && defined(__GLIBC__)
+#define STACK_CAPTURE_ENABLED
+#include <csignal>
+#include <cstdlib>
+#include <execinfo.h>
+#endif
+
+// interval of the pings, also the resolution of the stall detection
+constexpr const auto pingInterval = std::chrono::milliseconds(100);
+
+// interval in which the histogram is written to the log
+constexpr const qint64 histogramInterval = 5 * 60 * 1000;
+
+// the log file is rotated when it exceeds this size, one old file is kept
+constexpr const qint64 maxLogSize = 1024 * 1024;
+
+#ifdef STACK_CAPTURE_ENABLED
+// filled by the signal handler on the main thread
+static void *stackFrames[64];
+static std::atomic<int> stackDepth{-1};
+
+static void captureStackHandler(int)
+{
+    stackDepth.store(backtrace(stackFrames, int(std::size(stackFrames))));
+}
+#endif
+
+StallWatchdog::StallWatchdog(const QString &logDirectory, int threshold, bool captureStacks, QObject *parent)
+    : QObject(parent)
+{
+    this->_logFile = QString("%1/%2").arg(logDirectory, "diagnostics.log");
+    this->threshold = std::max(qint64(pingInterval.count()) * 2, qint64(threshold));
+    this->captureStacks = captureStacks;
+
+#ifdef Q_OS_UNIX
+    this->mainThread = pthread_self();
+#endif
+
+#ifdef STACK_CAPTURE_ENABLED
+    if (this->captureStacks)
+    {
+        // backtrace() loads libgcc on first use, preloading avoids the dlopen in the
+        // signal handler, the unwinding itself still isn't async-signal-safe
+        backtrace(stackFrames, 1);
+
+        struct sigaction action = {};
+        action.sa_handler = captureStackHandler;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGUSR2, &action, nullptr);
+    }
+#endif
+
+    this->writeLog(QString("watchdog started, stall threshold %1ms\n").arg(this->threshold).toUtf8());
+    this->thread = std::thread(&StallWatchdog::run, this);
+}
+
+StallWatchdog::~StallWatchdog()
+{
+    {
+        std::lock_guard lock(this->mutex);
+        this->running = false;
+    }
+    this->condition.notify_all();
+    this->thread.join();
+
+    this->writeLog(this->histogram().toUtf8());
+}
+
+const QString StallWatchdog::histogram() const
+{
+    quint64 total = 0;
+    for (auto&& bucket : this->buckets)
+    {
+        total += bucket.load();
+    }
+
+    QString text = QString("event loop lag (%1 samples, %2 stalls):\n").arg(total).arg(this->_stalls.load());
+    qint64 lower = 0;
+    for (std::size_t i = 0; i < bucketLimits.size(); ++i)
+    {
+        const auto count = this->buckets[i].load();
+        const auto range = bucketLimits[i] == std::numeric_limits<qint64>::max() ?
+            QString(">= %1ms").arg(lower) : QString("%1-%2ms").arg(lower).arg(bucketLimits[i]);
+        const auto bar = total > 0 ? QString(int(count * 50 / total), QLatin1Char('#')) : QString();
+        text.append(QString("  %1 %2 %3\n").arg(range, -12).arg(count, 8).arg(bar));
+        lower = bucketLimits[i];
+    }
+
+    return text;
+}
+
+const QString &StallWatchdog::logFile() const
+{
+    return this->_logFile;
+}
+
+quint64 StallWatchdog::stalls() const
+{
+    return this->_stalls.load();
+}
+
+void StallWatchdog::run()
+{
+    auto lastHistogram = StallWatchdog::now();
+
+    std::unique_lock lock(this->mutex);
+    while (this->running)
+    {
+        const auto now = StallWatchdog::now();
+        const auto sent = this->pingSent.load();
+
+        if (sent == 0)
+        {
+            this->pingSent.store(now);
+            QMetaObject::invokeMethod(this, [this, now]{
+                this->pong(now);
+            }, Qt::QueuedConnection);
+        }
+        else if (now - sent > this->threshold && !this->stallReported.exchange(true))
+        {
+            ++this->_stalls;
+            this->captureStack(now - sent);
+        }
+
+        if (now - lastHistogram > histogramInterval)
+        {
+            this->writeLog(this->histogram().toUtf8());
+            lastHistogram = now;
+        }
+
+        this->condition.wait_for(lock, pingInterval);
+    }
+}
+
+void StallWatchdog::pong(qint64 sent)
+{
+    const auto lag = StallWatchdog::now() - sent;
+
+    std::size_t bucket = 0;
+    while (lag >= bucketLimits[bucket])
+    {
+        ++bucket;
+    }
+    ++this->buckets[bucket];
+
+    if (this->stallReported.exchange(false))
+    {
+        this->writeLog(QString("stall ended after %1ms\n").arg(lag).toUtf8());
+    }
+
+    this->pingSent.store(0);
+}
+
+void StallWatchdog::captureStack(qint64 lag)
+{
+    QByteArray text = QString("stall: main thread blocked for %1ms\n").arg(lag).toUtf8();
+
+#ifdef STACK_CAPTURE_ENABLED
+    if (this->captureStacks)
+    {
+        stackDepth.store(-1);
+        pthread_kill(this->mainThread, SIGUSR2);
+
+        // the handler runs as soon as the main thread is scheduled
+        for (auto i = 0; i < 100 && stackDepth.load() < 0; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        const auto depth = stackDepth.load();
+        if (depth > 0)
+        {
+            auto symbols = backtrace_symbols(stackFrames, depth);
+            // skip the signal handler and the signal trampoline
+            for (auto i = 2; i < depth; ++i)
+            {
+                text.append("  ").append(symbols ? symbols[i] : "?").append('\n');
+            }
+            std::free(symbols);
+        }
+        else
+        {
+            text.append("  stack not available\n");
+        }
+    }
+#else
+    if (this->captureStacks)
+    {
+        text.append("  stack capture not supported on this platform\n");
+    }
+#endif
+
+    qWarning().noquote() << text.trimmed();
+    this->writeLog(text);
+}
+
+void StallWatchdog::writeLog(const QByteArray &text)
+{
+    std::lock_guard lock(this->logMutex);
+
+    QFile file(this->_logFile);
+    if (file.size() > maxLogSize)
+    {
+        const auto old = this->_logFile + ".1";
+        QFile::remove(old);
+        QFile::rename(this->_logFile, old);
+    }
+
+    if (file.open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        file.write(QDateTime::currentDateTime().toString(Qt::ISODateWithMs).toUtf8() + ' ' + text);
+    }
+}
+
+qint64 StallWatchdog::now()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
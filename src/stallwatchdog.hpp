@@ -0,0 +1,79 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+#ifdef Q_OS_UNIX
+#include <pthread.h>
+#endif
+
+/**
+ * Detects stalls of the GUI thread.
+ *
+ * A watchdog thread posts a ping to the main event loop and measures how
+ * long it takes to be handled. The latencies are collected in a histogram.
+ * When a ping stays unhandled for longer than the threshold, the stall is
+ * logged. With captureStacks the stack of the main thread is captured with
+ * backtrace() from a SIGUSR2 handler. backtrace() isn't async-signal-safe,
+ * it may take locks of the unwinder the interrupted thread already holds
+ * and then deadlocks the main thread, so capturing is best-effort and off
+ * by default. Stacks and the histogram are written to a rotating log file.
+ */
+class StallWatchdog : public QObject
+{
+    Q_OBJECT
+
+public:
+    StallWatchdog(const QString &logDirectory, int threshold, bool captureStacks, QObject *parent = nullptr);
+    ~StallWatchdog();
+
+    // upper bounds of the histogram buckets in ms
+    static constexpr const std::array<qint64, 9> bucketLimits = {
+        16, 33, 50, 100, 250, 500, 1000, 5000, std::numeric_limits<qint64>::max()};
+
+    /**
+     * Event loop lag histogram as human readable text.
+     */
+    const QString histogram() const;
+
+    /**
+     * Path of the current log file.
+     */
+    const QString &logFile() const;
+
+    quint64 stalls() const;
+
+private:
+    void run();
+    void pong(qint64 sent);
+    void captureStack(qint64 lag);
+    void writeLog(const QByteArray &text);
+
+    static qint64 now();
+
+    QString _logFile;
+    qint64 threshold;
+    bool captureStacks;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::mutex logMutex;
+    std::condition_variable condition;
+    bool running = true;
+
+    std::atomic<qint64> pingSent{0}; // 0 when no ping is pending
+    std::atomic<bool> stallReported{false};
+    std::atomic<quint64> _stalls{0};
+    std::array<std::atomic<quint64>, bucketLimits.size()> buckets{};
+
+#ifdef Q_OS_UNIX
+    pthread_t mainThread;
+#endif
+};
@@ -0,0 +1,165 @@
+#include "storageanalyzer.hpp"
+
+#include <QDirIterator>
+#include <QJsonArray>
+#include <QFileInfo>
+#include <QFile>
+#include <QMap>
+#include <QDir>
+
+#include <algorithm>
+
+// directory names of the Chromium storage, the first match from the file upwards wins
+static const QList<QPair<QString, QString>> storageTypes = {
+    {"IndexedDB",       "indexeddb"},
+    {"CacheStorage",    "service-worker-cache"},
+    {"Service Worker",  "service-worker"},
+    {"Local Storage",   "local-storage"},
+    {"Session Storage", "session-storage"},
+    {"File System",     "file-system"},
+    {"databases",       "web-sql"},
+    {"Code Cache",      "code-cache"},
+    {"GPUCache",        "gpu-cache"},
+    {"MediaCache",      "media-cache"},
+    {"CacheHotSet",     "http-cache"},
+    {"Cache_Data",      "http-cache"},
+    {"Cache",           "http-cache"},
+};
+
+// storage types which are rebuilt by Chromium on demand, the code cache
+// is kept because dropping it slows down the next start
+static const QStringList prunableTypes = {
+    "http-cache",
+    "gpu-cache",
+};
+
+StorageAnalyzer::StorageAnalyzer(const QString &profilePath)
+{
+    this->profilePath = profilePath;
+}
+
+const QList<StorageAnalyzer::Item> StorageAnalyzer::analyze() const
+{
+    QMap<QPair<QString, QString>, Item> items;
+    const QDir root(this->profilePath);
+
+    QDirIterator it(this->profilePath, QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        it.next();
+        const auto components = root.relativeFilePath(it.filePath()).split('/');
+        const auto type = StorageAnalyzer::typeOf(components);
+        const auto origin = type == "indexeddb" ? StorageAnalyzer::originOf(components) : QString();
+
+        auto &item = items[{type, origin}];
+        item.type = type;
+        item.origin = origin;
+        item.bytes += it.fileInfo().size();
+        ++item.files;
+    }
+
+    auto list = items.values();
+    std::sort(list.begin(), list.end(), [](const Item &a, const Item &b){
+        return a.bytes > b.bytes;
+    });
+    return list;
+}
+
+const QJsonObject StorageAnalyzer::report() const
+{
+    qint64 total = 0;
+    QMap<QString, qint64> types;
+    QJsonArray items;
+
+    for (auto&& item : this->analyze())
+    {
+        total += item.bytes;
+        types[item.type] += item.bytes;
+        items.append(QJsonObject{
+            {"type", item.type},
+            {"origin", item.origin},
+            {"bytes", item.bytes},
+            {"files", item.files},
+        });
+    }
+
+    QJsonObject typesObject;
+    for (auto it = types.cbegin(); it != types.cend(); ++it)
+    {
+        typesObject.insert(it.key(), it.value());
+    }
+
+    return {
+        {"path", this->profilePath},
+        {"bytes", total},
+        {"types", typesObject},
+        {"items", items},
+    };
+}
+
+qint64 StorageAnalyzer::compact() const
+{
+    qint64 reclaimed = 0;
+    const QDir root(this->profilePath);
+
+    QDirIterator it(this->profilePath, QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        it.next();
+        const auto components = root.relativeFilePath(it.filePath()).split('/');
+
+        // LevelDB keeps human readable logs next to every database
+        const auto name = it.fileName();
+        const bool levelDbLog = (name == "LOG" || name == "LOG.old") &&
+            QFileInfo::exists(QString("%1/%2").arg(it.fileInfo().path(), "CURRENT"));
+
+        if (levelDbLog || prunableTypes.contains(StorageAnalyzer::typeOf(components)))
+        {
+            const auto size = it.fileInfo().size();
+            if (QFile::remove(it.filePath()))
+            {
+                reclaimed += size;
+            }
+        }
+    }
+
+    return reclaimed;
+}
+
+const QString StorageAnalyzer::typeOf(const QStringList &components)
+{
+    for (auto i = components.size() - 2; i >= 0; --i)
+    {
+        for (auto&& [directory, type] : storageTypes)
+        {
+            if (components.at(i) == directory)
+            {
+                return type;
+            }
+        }
+    }
+
+    return "other";
+}
+
+const QString StorageAnalyzer::originOf(const QStringList &components)
+{
+    // IndexedDB/<scheme>_<host>_<port>.indexeddb.leveldb, the port is 0 for the default port
+    const auto index = components.indexOf("IndexedDB");
+    if (index < 0 || index + 1 >= components.size())
+    {
+        return {};
+    }
+
+    const auto directory = components.at(index + 1);
+    auto parts = directory.left(directory.indexOf(".indexeddb")).split('_');
+    if (parts.size() < 3)
+    {
+        return directory;
+    }
+
+    const auto scheme = parts.takeFirst();
+    const auto port = parts.takeLast();
+    const auto host = parts.join('_');
+    return port == "0" ? QString("%1://%2").arg(scheme, host) : QString("%1://%2:%3").arg(scheme, host, port);
+}
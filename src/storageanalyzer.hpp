@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QString>
+#include <QList>
+#include <QJsonObject>
+
+/**
+ * Breaks down the disk usage of a profile directory by storage type
+ * and origin and prunes the parts which are safe to delete offline.
+ * Works on the files only and doesn't require QtWebEngine, the profile
+ * must not be in use while compacting.
+ */
+class StorageAnalyzer
+{
+public:
+    explicit StorageAnalyzer(const QString &profilePath);
+
+    struct Item
+    {
+        QString type;   // indexeddb, http-cache, service-worker-cache, ...
+        QString origin; // empty when the storage isn't per origin
+        qint64 bytes = 0;
+        qint64 files = 0;
+    };
+
+    /**
+     * Disk usage per type and origin, sorted by size.
+     */
+    const QList<Item> analyze() const;
+
+    /**
+     * Report as JSON with the total size, the size per type and all items.
+     */
+    const QJsonObject report() const;
+
+    /**
+     * Deletes the HTTP and GPU shader caches and the text logs of the
+     * LevelDB databases. Returns the number of bytes reclaimed. IndexedDB
+     * isn't compacted, its databases use a comparator of Chromium.
+     */
+    qint64 compact() const;
+
+private:
+    static const QString typeOf(const QStringList &components);
+    static const QString originOf(const QStringList &components);
+
+    QString profilePath;
+};
@@ -0,0 +1,143 @@
+#include "trace.hpp"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QCoreApplication>
+
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Event
+    {
+        const char *name;
+        char phase;
+        std::int64_t timestamp;
+        int thread;
+        std::int64_t value;
+    };
+
+    // initialized during static initialization, close enough to the process start
+    const auto origin = std::chrono::steady_clock::now();
+
+    std::string outputFile;
+    std::mutex mutex;
+    std::vector<Event> events;
+    std::atomic<int> threadCounter{0};
+
+    inline std::int64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - origin).count();
+    }
+
+    inline int currentThread()
+    {
+        thread_local const int id = ++threadCounter;
+        return id;
+    }
+
+    inline void record(const char *name, char phase, std::int64_t value = 0)
+    {
+        const Event event{name, phase, now(), currentThread(), value};
+        std::lock_guard lock(mutex);
+        events.push_back(event);
+    }
+}
+
+void Trace::initialize(int argc, char **argv)
+{
+    constexpr const char option[] = "--trace-startup=";
+    constexpr const auto optionLength = sizeof(option) - 1;
+
+    for (auto i = 1; i < argc; ++i)
+    {
+        if (std::strncmp(argv[i], option, optionLength) == 0 && argv[i][optionLength] != '\0')
+        {
+            outputFile = argv[i] + optionLength;
+            events.reserve(256);
+            detail::enabled = true;
+            std::atexit(Trace::write);
+            break;
+        }
+    }
+}
+
+void Trace::write()
+{
+    if (!detail::enabled)
+    {
+        return;
+    }
+
+    std::lock_guard lock(mutex);
+
+    QJsonArray traceEvents;
+    const auto pid = qint64(QCoreApplication::applicationPid());
+
+    for (auto&& event : events)
+    {
+        QJsonObject object{
+            {"name", event.name},
+            {"cat", "startup"},
+            {"ph", QString(QLatin1Char(event.phase))},
+            {"ts", qint64(event.timestamp)},
+            {"pid", pid},
+            {"tid", event.thread},
+        };
+
+        if (event.phase == 'C')
+        {
+            object.insert("args", QJsonObject{{"value", qint64(event.value)}});
+        }
+        else if (event.phase == 'i')
+        {
+            object.insert("s", "p");
+        }
+
+        traceEvents.append(object);
+    }
+
+    QFile file(QString::fromStdString(outputFile));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        std::fprintf(stderr, "unable to write startup trace to %s\n", outputFile.c_str());
+        return;
+    }
+
+    file.write(QJsonDocument(QJsonObject{
+        {"traceEvents", traceEvents},
+        {"displayTimeUnit", "ms"},
+    }).toJson(QJsonDocument::Compact));
+
+    // only write once, even when called explicitly before exit
+    detail::enabled = false;
+}
+
+void Trace::begin(const char *name)
+{
+    record(name, 'B');
+}
+
+void Trace::end(const char *name)
+{
+    record(name, 'E');
+}
+
+void Trace::instant(const char *name)
+{
+    record(name, 'i');
+}
+
+void Trace::counter(const char *name, std::int64_t value)
+{
+    record(name, 'C', value);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Lightweight startup tracing which writes a Chrome trace event file
+ * (chrome://tracing, Perfetto) on exit.
+ *
+ * Tracing is enabled at runtime with --trace-startup=<file>. When the
+ * build option is disabled all macros expand to nothing.
+ */
+namespace Trace
+{
+    /**
+     * Scans the raw command line for --trace-startup=<file> and enables
+     * tracing. Must be called at the very beginning of main().
+     */
+    void initialize(int argc, char **argv);
+
+    /**
+     * Writes all recorded events, called automatically on exit.
+     */
+    void write();
+
+    namespace detail
+    {
+        // only written once in initialize() before any other thread exists
+        inline bool enabled = false;
+    }
+
+    inline bool isEnabled()
+    {
+        return detail::enabled;
+    }
+
+    void begin(const char *name);
+    void end(const char *name);
+    void instant(const char *name);
+    void counter(const char *name, std::int64_t value);
+
+    class Scope
+    {
+    public:
+        inline Scope(const char *name)
+            : name(isEnabled() ? name : nullptr)
+        {
+            if (this->name)
+            {
+                begin(this->name);
+            }
+        }
+
+        inline ~Scope()
+        {
+            if (this->name)
+            {
+                end(this->name);
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope &operator= (const Scope&) = delete;
+
+    private:
+        const char *name;
+    };
+}
+
+#ifdef STARTUP_TRACING_ENABLED
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_SCOPE(name) const Trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_BEGIN(name) do { if (Trace::isEnabled()) Trace::begin(name); } while (false)
+#define TRACE_END(name) do { if (Trace::isEnabled()) Trace::end(name); } while (false)
+#define TRACE_INSTANT(name) do { if (Trace::isEnabled()) Trace::instant(name); } while (false)
+#define TRACE_COUNTER(name, value) do { if (Trace::isEnabled()) Trace::counter(name, value); } while (false)
+#else
+#define TRACE_SCOPE(name) do {} while (false)
+#define TRACE_BEGIN(name) do {} while (false)
+#define TRACE_END(name) do {} while (false)
+#define TRACE_INSTANT(name) do {} while (false)
+#define TRACE_COUNTER(name, value) do {} while (false)
+#endif
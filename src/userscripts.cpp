@@ -0,0 +1,135 @@
+#include "userscripts.hpp"
+
+#include <QApplication>
+#include <QWebEngineProfile>
+#include <QWebEngineScriptCollection>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSysInfo>
+#include <QFile>
+#include <QDebug>
+
+// converts a string into a JavaScript string literal
+static QString stringLiteral(const QString &value)
+{
+    const auto array = QJsonDocument(QJsonArray{value}).toJson(QJsonDocument::Compact);
+    return QString::fromUtf8(array.mid(1, array.size() - 2));
+}
+
+void UserScripts::install(QWebEngineProfile *profile)
+{
+    for (auto&& script : UserScripts::scripts())
+    {
+        UserScripts::insert(profile, script);
+    }
+}
+
+#ifdef NATIVE_CRYPTO_ENABLED
+void UserScripts::installNativeCrypto(QWebEngineProfile *profile)
+{
+    static const auto script = UserScripts::load("native-crypto");
+    UserScripts::installWebChannel(profile);
+    UserScripts::insert(profile, script);
+}
+#endif
+
+void UserScripts::installEventIndex(QWebEngineProfile *profile)
+{
+    static const auto script = UserScripts::load("event-index");
+    UserScripts::installWebChannel(profile);
+    UserScripts::insert(profile, script);
+}
+
+void UserScripts::installWebChannel(QWebEngineProfile *profile)
+{
+    static const auto script = []{
+        // client library embedded into Qt WebChannel, kept private to the scripts
+        QFile file(":/qtwebchannel/qwebchannel.js");
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            qWarning() << "unable to load qwebchannel.js";
+        }
+        return UserScripts::load("web-channel", {
+            {"__QWEBCHANNEL__", QString::fromUtf8(file.readAll())},
+        });
+    }();
+
+    // must be inserted before the scripts which use the channel
+    UserScripts::insert(profile, script);
+}
+
+void UserScripts::insert(QWebEngineProfile *profile, const QWebEngineScript &script)
+{
+    auto collection = profile->scripts();
+    if (!collection->contains(script))
+    {
+        qDebug() << "install script:" << script.name();
+        collection->insert(script);
+    }
+}
+
+const QList<QWebEngineScript> &UserScripts::scripts()
+{
+    static const QList<QWebEngineScript> scripts{
+        // homeserver url for the network monitor
+        UserScripts::load("homeserver-url"),
+
+        // notifications are reset to disabled on every app restart and reload
+        UserScripts::load("notification-fixer"),
+
+        // device name shown in the session list of other clients
+        UserScripts::load("device-name", {
+            {"__DEVICE_NAME__", stringLiteral(QString("%1 (%2)").arg(qApp->applicationDisplayName(), QSysInfo::prettyProductName()))},
+        }),
+
+        // app ready marker for the benchmark and the startup placeholder
+        UserScripts::load("app-ready"),
+    };
+
+    return scripts;
+}
+
+QWebEngineScript UserScripts::load(const QString &name, const QHash<QString, QString> &variables)
+{
+    static const auto read = [](const QString &name) {
+        QFile file(QString(":/scripts/%1.js").arg(name));
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            qWarning() << "unable to load embedded script:" << name;
+            return QString();
+        }
+        return QString::fromUtf8(file.readAll());
+    };
+    static const auto prelude = read("prelude");
+
+    auto source = read(name);
+    for (auto it = variables.cbegin(); it != variables.cend(); ++it)
+    {
+        source.replace(it.key(), it.value());
+    }
+
+    // isolate the helpers of each script in its own function scope
+    QWebEngineScript script;
+    script.setName(name);
+    script.setWorldId(QWebEngineScript::MainWorld);
+    script.setInjectionPoint(QWebEngineScript::DocumentCreation);
+    script.setRunsOnSubFrames(false);
+    script.setSourceCode(UserScripts::minify(QString("(() => {\n%1\n%2\n})();").arg(prelude, source)));
+    return script;
+}
+
+QString UserScripts::minify(const QString &source)
+{
+    // the embedded scripts don't contain // in strings, which makes it safe
+    // to drop comment lines and indentation
+    QStringList lines;
+    for (auto&& line : source.split('\n'))
+    {
+        const auto trimmed = line.trimmed();
+        if (!trimmed.isEmpty() && !trimmed.startsWith("//"))
+        {
+            lines.append(trimmed);
+        }
+    }
+    return lines.join('\n');
+}
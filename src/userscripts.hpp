@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QList>
+#include <QHash>
+#include <QString>
+#include <QWebEngineScript>
+
+class QWebEngineProfile;
+
+/**
+ * Scripts injected into element-web. The sources are embedded into the
+ * binary and loaded only once per process. Every script is injected on
+ * document creation and hooks into element-web globals, instead of polling
+ * until element-web finished loading.
+ */
+class UserScripts
+{
+public:
+    /**
+     * Installs all scripts into the given profile, does nothing for
+     * scripts which are already installed.
+     */
+    static void install(QWebEngineProfile *profile);
+
+#ifdef NATIVE_CRYPTO_ENABLED
+    /**
+     * Installs the window.qelementCrypto shim,
+     * the page must have a web channel with a NativeCrypto object.
+     */
+    static void installNativeCrypto(QWebEngineProfile *profile);
+#endif
+
+    /**
+     * Installs the event indexing manager of the platform,
+     * the page must have a web channel with an EventIndex object.
+     */
+    static void installEventIndex(QWebEngineProfile *profile);
+
+private:
+    // QWebChannel client shared by all scripts which talk to native objects
+    static void installWebChannel(QWebEngineProfile *profile);
+    static void insert(QWebEngineProfile *profile, const QWebEngineScript &script);
+
+    static const QList<QWebEngineScript> &scripts();
+    static QWebEngineScript load(const QString &name, const QHash<QString, QString> &variables = {});
+    static QString minify(const QString &source);
+};
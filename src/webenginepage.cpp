@@ -1,11 +1,54 @@
 #include "webenginepage.hpp"
+#include "consolelog.hpp"
 
 #include <QDesktopServices>
 
+#include <functional>
+
+// hidden page for scripts which open an empty window and navigate it afterwards,
+// every navigation is handed to the opener instead of being loaded
+class ExternalLinkPage : public QWebEnginePage
+{
+public:
+    ExternalLinkPage(QWebEngineProfile *profile, std::function<void(const QUrl&)> open)
+        : QWebEnginePage(profile)
+    {
+        this->open = std::move(open);
+    }
+
+protected:
+    bool acceptNavigationRequest(const QUrl &url, QWebEnginePage::NavigationType, bool) override
+    {
+        if (url.isEmpty() || url.scheme() == "about")
+        {
+            return true;
+        }
+
+        this->open(url);
+        return false;
+    }
+
+private:
+    std::function<void(const QUrl&)> open;
+};
+
 WebEnginePage::WebEnginePage(QWebEngineProfile *profile, QObject *parent)
     : QWebEnginePage(profile, parent)
 {
     this->profile = profile;
+    connect(this, &QWebEnginePage::newWindowRequested, this, &WebEnginePage::handleNewWindow);
+}
+
+WebEnginePage::~WebEnginePage() = default;
+
+void WebEnginePage::setConsoleLog(ConsoleLog *consoleLog)
+{
+    this->consoleLog = consoleLog;
+}
+
+void WebEnginePage::setOpenExternalLinks(bool enabled)
+{
+    this->openExternalLinks = enabled;
 }
 
 bool WebEnginePage::acceptNavigationRequest(const QUrl &url, QWebEnginePage::NavigationType type, bool)
@@ -31,23 +74,49 @@ bool WebEnginePage::acceptNavigationRequest(const QUrl &url, QWebEnginePage::Nav
 
 WebEnginePage *WebEnginePage::createWindow(WebWindowType type)
 {
-    // open url in system web browser if target is outside of the application
-    auto self = new WebEnginePage(this->profile);
-    connect(self, &QWebEnginePage::urlChanged, self, &WebEnginePage::openExternalUrl);
-    return self;
+    // only called after newWindowRequested when the handler didn't adopt the window,
+    // that handler already opened its url, the window is discarded without a page
+    Q_UNUSED(type);
+    return nullptr;
+}
+
+void WebEnginePage::handleNewWindow(QWebEngineNewWindowRequest &request)
+{
+    // open url in system web browser, the new window is discarded without being loaded
+    const auto url = request.requestedUrl();
+    if (!url.isEmpty() && url.scheme() != "about")
+    {
+        this->openExternalUrl(url);
+        return;
+    }
+
+    // the target is only known after the script navigated the window, a new window
+    // replaces the contents of the previous one in the shared page
+    if (!this->externalLinkPage)
+    {
+        this->externalLinkPage = std::make_unique<ExternalLinkPage>(this->profile, [this](const QUrl &url) {
+            this->openExternalUrl(url);
+        });
+    }
+    request.openIn(this->externalLinkPage.get());
 }
 
 void WebEnginePage::javaScriptConsoleMessage(QWebEnginePage::JavaScriptConsoleMessageLevel level, const QString &message, int lineNumber, const QString &sourceID)
 {
-    // do nothing, remove console spam
+    // keep the console out of the log, but record it for diagnostics
+    if (this->consoleLog)
+    {
+        this->consoleLog->record(int(level), message, lineNumber, sourceID);
+    }
 }
 
 void WebEnginePage::openExternalUrl(const QUrl &url)
 {
     qDebug() << "openExternalUrl:" << url;
-    QDesktopServices::openUrl(url);
+    emit externalLinkRequested(url);
 
-    // FIXME: suspicious memory leak
-    qobject_cast<WebEnginePage*>(this->sender())->deleteLater();
-    delete qobject_cast<WebEnginePage*>(this->sender());
+    if (this->openExternalLinks)
+    {
+        QDesktopServices::openUrl(url);
+    }
 }
@@ -3,12 +3,27 @@
 #include <QtWebEngineCore>
 #include <QtWebEngineWidgets>
 
+#include <memory>
+
+class ConsoleLog;
+class ExternalLinkPage;
+
 class WebEnginePage : public QWebEnginePage
 {
     Q_OBJECT
 
 public:
     explicit WebEnginePage(QWebEngineProfile *profile, QObject *parent = nullptr);
+    ~WebEnginePage();
+
+    // records the console messages, they are discarded without a log
+    void setConsoleLog(ConsoleLog *consoleLog);
+
+    // links which open a new window are handed to the system web browser unless disabled
+    void setOpenExternalLinks(bool enabled);
+
+signals:
+    void externalLinkRequested(const QUrl &url);
 
 protected:
     bool acceptNavigationRequest(const QUrl &url, QWebEnginePage::NavigationType type, bool);
@@ -17,7 +32,13 @@ protected:
     void javaScriptConsoleMessage(QWebEnginePage::JavaScriptConsoleMessageLevel level, const QString &message, int lineNumber, const QString &sourceID);
 
 private:
+    void handleNewWindow(QWebEngineNewWindowRequest &request);
     void openExternalUrl(const QUrl &url);
 
     QWebEngineProfile *profile;
+    ConsoleLog *consoleLog = nullptr;
+    bool openExternalLinks = true;
+
+    // adopts windows which are opened without a url, created on first use
+    std::unique_ptr<ExternalLinkPage> externalLinkPage;
 };